@@ -20,7 +20,11 @@ namespace Audio
 	FAudioPlatformSettings FOmniverseMixerDevice::GetPlatformSettings() const
 	{
 		FAudioPlatformSettings Settings = FMixerDevice::GetPlatformSettings();
-		Settings.SampleRate = SampleRate;
+		// 0 keeps the platform rate
+		if (SampleRate > 0)
+		{
+			Settings.SampleRate = SampleRate;
+		}
 		return Settings;
 	}
 }
@@ -18,6 +18,7 @@ public:
 
 	void SetPlatformInterface(Audio::IAudioMixerPlatformInterface* Interface);
 
+	// Rate of the created devices, 0 is the rate of the platform settings
 	void SetSampleRate(uint32 InSampleRate) { SampleRate = InSampleRate; }
 
 	virtual FAudioDevice* CreateAudioDevice() override;
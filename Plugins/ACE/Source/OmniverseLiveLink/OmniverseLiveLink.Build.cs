@@ -6,6 +6,7 @@
 // distribution of this software and related documentation without an express
 // license agreement from NVIDIA CORPORATION is strictly prohibited.
 
+using System.IO;
 using UnrealBuildTool;
 
 public class OmniverseLiveLink : ModuleRules
@@ -22,7 +23,8 @@ public class OmniverseLiveLink : ModuleRules
                 "Sockets",
                 "Json",
                 "JsonUtilities",
-                "LiveLinkInterface"
+                "LiveLinkInterface",
+                "AudioMixer"
             }
             );
 
@@ -44,5 +46,11 @@ public class OmniverseLiveLink : ModuleRules
 				"OmniverseAudioMixer",
 			}
 			);
+
+        // Opus packets on the wave stream port
+        AddEngineThirdPartyPrivateStaticDependencies(Target, "libOpus");
+
+        // FSocketBSD, the socket thread polls the native handles of its sockets at once
+        PrivateIncludePaths.Add(Path.Combine(EngineDirectory, "Source/Runtime/Sockets/Private"));
     }
 }
@@ -11,4 +11,6 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
 DECLARE_LOG_CATEGORY_EXTERN(LogACE, Log, All);
+DECLARE_STATS_GROUP(TEXT("ACE"), STATGROUP_ACE, STATCAT_Advanced);
@@ -0,0 +1,206 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "OmniverseAudioRing.h"
+
+
+void FOmniverseAudioRing::Init(int32 InCapacity)
+{
+	Capacity = FMath::RoundUpToPowerOfTwo(FMath::Max(InCapacity, 1024));
+	Buffer.SetNumZeroed(Capacity);
+	WritePosition = 0;
+	ReadPosition = 0;
+	PendingSegment.Reset();
+	RemainingSampleBytes = 0;
+}
+
+void FOmniverseAudioRing::WriteBytes(uint64 InPosition, const void* InData, int32 InSize)
+{
+	const int32 Offset = (int32)(InPosition & (Capacity - 1));
+	const int32 FirstSize = FMath::Min(InSize, (int32)Capacity - Offset);
+	FMemory::Memcpy(Buffer.GetData() + Offset, InData, FirstSize);
+	FMemory::Memcpy(Buffer.GetData(), (const uint8*)InData + FirstSize, InSize - FirstSize);
+}
+
+void FOmniverseAudioRing::ReadBytes(uint64 InPosition, void* OutData, int32 InSize) const
+{
+	const int32 Offset = (int32)(InPosition & (Capacity - 1));
+	const int32 FirstSize = FMath::Min(InSize, (int32)Capacity - Offset);
+	FMemory::Memcpy(OutData, Buffer.GetData() + Offset, FirstSize);
+	FMemory::Memcpy((uint8*)OutData + FirstSize, Buffer.GetData(), InSize - FirstSize);
+}
+
+int64 FOmniverseAudioRing::GetFreeBytes() const
+{
+	return (int64)(Capacity - (WritePosition.load(std::memory_order_relaxed) - ReadPosition.load(std::memory_order_acquire)));
+}
+
+void FOmniverseAudioRing::RecordFill()
+{
+	const int64 FillBytes = (int64)Capacity - GetFreeBytes();
+	if (FillBytes > PeakFillBytes.load(std::memory_order_relaxed))
+	{
+		PeakFillBytes.store(FillBytes, std::memory_order_relaxed);
+	}
+}
+
+bool FOmniverseAudioRing::TryWriteSegment(const FOmniverseAudioSegment& InSegment)
+{
+	const FRecordHeader Header = { ERecordType::Segment, sizeof(FOmniverseAudioSegment) };
+	if (GetFreeBytes() < (int64)(sizeof(Header) + sizeof(InSegment)))
+	{
+		return false;
+	}
+
+	const uint64 Position = WritePosition.load(std::memory_order_relaxed);
+	WriteBytes(Position, &Header, sizeof(Header));
+	WriteBytes(Position + sizeof(Header), &InSegment, sizeof(InSegment));
+	WritePosition.store(Position + sizeof(Header) + sizeof(InSegment), std::memory_order_release);
+	return true;
+}
+
+void FOmniverseAudioRing::PushSegment(const FOmniverseAudioSegment& InSegment)
+{
+	if (InSegment.bStreamEnd)
+	{
+		if (!PendingSegment.IsSet())
+		{
+			TryWriteSegment(InSegment);
+		}
+		return;
+	}
+
+	// A newer marker replaces the one still waiting, none of its samples were written
+	if (PendingSegment.IsSet() || !TryWriteSegment(InSegment))
+	{
+		PendingSegment = InSegment;
+	}
+}
+
+int32 FOmniverseAudioRing::PushSamples(const uint8* InData, int32 InSize, int32 InFrameBytes)
+{
+	if (InSize <= 0)
+	{
+		return 0;
+	}
+
+	int32 WriteSize = 0;
+	if (!PendingSegment.IsSet() || TryWriteSegment(PendingSegment.GetValue()))
+	{
+		PendingSegment.Reset();
+
+		// Room for a marker is kept, so the next stream isn't dropped because of the samples of this one
+		const int64 FitSize = GetFreeBytes() - (int64)(sizeof(FRecordHeader) * 2 + sizeof(FOmniverseAudioSegment));
+		WriteSize = InSize;
+		if (FitSize < InSize)
+		{
+			const int32 FrameBytes = FMath::Max(InFrameBytes, 1);
+			const int32 DropSize = FMath::Min(InSize, (int32)FMath::DivideAndRoundUp(InSize - FMath::Max<int64>(FitSize, 0), (int64)FrameBytes) * FrameBytes);
+			WriteSize = InSize - DropSize;
+		}
+
+		if (WriteSize > 0)
+		{
+			const FRecordHeader Header = { ERecordType::Samples, (uint32)WriteSize };
+			const uint64 Position = WritePosition.load(std::memory_order_relaxed);
+			WriteBytes(Position, &Header, sizeof(Header));
+			WriteBytes(Position + sizeof(Header), InData, WriteSize);
+			WritePosition.store(Position + sizeof(Header) + WriteSize, std::memory_order_release);
+			RecordFill();
+		}
+	}
+
+	if (WriteSize < InSize)
+	{
+		DroppedBytes.fetch_add(InSize - WriteSize, std::memory_order_relaxed);
+		NumOverflows.fetch_add(1, std::memory_order_relaxed);
+	}
+	return WriteSize;
+}
+
+bool FOmniverseAudioRing::PopSegment(FOmniverseAudioSegment& OutSegment)
+{
+	const uint64 Position = ReadPosition.load(std::memory_order_relaxed);
+	if (RemainingSampleBytes > 0 || WritePosition.load(std::memory_order_acquire) == Position)
+	{
+		return false;
+	}
+
+	FRecordHeader Header;
+	ReadBytes(Position, &Header, sizeof(Header));
+	if (Header.Type != ERecordType::Segment)
+	{
+		return false;
+	}
+
+	ReadBytes(Position + sizeof(Header), &OutSegment, sizeof(OutSegment));
+	ReadPosition.store(Position + sizeof(Header) + sizeof(OutSegment), std::memory_order_release);
+	return true;
+}
+
+int32 FOmniverseAudioRing::PopSamples(uint8* OutData, int32 InMaxSize)
+{
+	uint64 Position = ReadPosition.load(std::memory_order_relaxed);
+	const uint64 EndPosition = WritePosition.load(std::memory_order_acquire);
+
+	int32 PopSize = 0;
+	while (PopSize < InMaxSize && Position < EndPosition)
+	{
+		if (RemainingSampleBytes == 0)
+		{
+			FRecordHeader Header;
+			ReadBytes(Position, &Header, sizeof(Header));
+			if (Header.Type != ERecordType::Samples)
+			{
+				break;
+			}
+			Position += sizeof(Header);
+			RemainingSampleBytes = Header.Size;
+		}
+
+		const int32 Size = FMath::Min(InMaxSize - PopSize, (int32)RemainingSampleBytes);
+		ReadBytes(Position, OutData + PopSize, Size);
+		Position += Size;
+		PopSize += Size;
+		RemainingSampleBytes -= Size;
+	}
+
+	ReadPosition.store(Position, std::memory_order_release);
+	return PopSize;
+}
+
+void FOmniverseAudioRing::Discard(uint64 InPosition)
+{
+	uint64 Position = ReadPosition.load(std::memory_order_relaxed);
+	const uint64 EndPosition = FMath::Min(InPosition, WritePosition.load(std::memory_order_acquire));
+
+	// The rest of the sample record being read, then whole records
+	Position += RemainingSampleBytes;
+	RemainingSampleBytes = 0;
+	while (Position < EndPosition)
+	{
+		FRecordHeader Header;
+		ReadBytes(Position, &Header, sizeof(Header));
+		Position += sizeof(Header) + Header.Size;
+	}
+
+	ReadPosition.store(Position, std::memory_order_release);
+}
+
+FOmniverseAudioRingStats FOmniverseAudioRing::GetStats() const
+{
+	FOmniverseAudioRingStats Stats;
+	Stats.Capacity = (int64)Capacity;
+	// Read first, the write position can only be ahead of it
+	const uint64 Position = ReadPosition.load(std::memory_order_acquire);
+	Stats.FillBytes = (int64)(WritePosition.load(std::memory_order_acquire) - Position);
+	Stats.PeakFillBytes = PeakFillBytes.load(std::memory_order_relaxed);
+	Stats.DroppedBytes = DroppedBytes.load(std::memory_order_relaxed);
+	Stats.NumOverflows = NumOverflows.load(std::memory_order_relaxed);
+	return Stats;
+}
@@ -0,0 +1,103 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "OmniverseWaveDef.h"
+#include "OmniverseRenderCheck.h"
+#include <atomic>
+
+// Start of a segment of the ring, the samples after it are in its format
+struct FOmniverseAudioSegment
+{
+	FOmniverseWaveFormatInfo Format;
+	// A new stream of its connection, not the continuation of the samples of another connection
+	bool bStreamStart = false;
+	// End of the stream of its connection, the format doesn't change
+	bool bStreamEnd = false;
+};
+
+// Fill level of a ring, read from any thread
+struct FOmniverseAudioRingStats
+{
+	int64 Capacity = 0;
+	int64 FillBytes = 0;
+	int64 PeakFillBytes = 0;
+	int64 DroppedBytes = 0;
+	int64 NumOverflows = 0;
+};
+
+// Fixed capacity ring of sample bytes between one producer and one consumer thread, nothing is allocated or locked after Init().
+// Segment markers are inline records, so the consumer changes format exactly where the producer did.
+// Overflow policy: the newest samples which don't fit are dropped in whole frames and counted. A marker which doesn't fit
+// is kept by the producer and written before any later sample, the samples are dropped until it's written.
+// An end marker which doesn't fit is dropped
+class FOmniverseAudioRing
+{
+public:
+	// Capacity in bytes, rounded up to a power of two
+	void Init(int32 InCapacity);
+
+	// Producer thread
+	void PushSegment(const FOmniverseAudioSegment& InSegment);
+	// Returns the bytes written, the bytes dropped are whole frames of InFrameBytes
+	int32 PushSamples(const uint8* InData, int32 InSize, int32 InFrameBytes);
+
+	// Consumer thread
+	// The next record is a marker, popped into OutSegment
+	bool PopSegment(FOmniverseAudioSegment& OutSegment);
+	// Sample bytes up to the next marker
+	int32 PopSamples(uint8* OutData, int32 InMaxSize);
+	bool IsEmpty() const { return ReadPosition.load(std::memory_order_relaxed) == WritePosition.load(std::memory_order_acquire); }
+	// The records before InPosition are dropped, a write position taken by any thread
+	void Discard(uint64 InPosition);
+
+	// Any thread: the end of the records written so far
+	uint64 GetWritePosition() const { return WritePosition.load(std::memory_order_acquire); }
+
+	FOmniverseAudioRingStats GetStats() const;
+
+#if WITH_DEV_AUTOMATION_TESTS
+	uint32 HashBuffers(uint32 InHash) const { return FOmniverseRenderCheck::HashBuffer(Buffer, InHash); }
+#endif
+
+private:
+	enum class ERecordType : uint32
+	{
+		Samples,
+		Segment,
+	};
+
+	struct FRecordHeader
+	{
+		ERecordType Type;
+		uint32 Size;
+	};
+
+	// Records wrap around the end of the buffer
+	void WriteBytes(uint64 InPosition, const void* InData, int32 InSize);
+	void ReadBytes(uint64 InPosition, void* OutData, int32 InSize) const;
+	bool TryWriteSegment(const FOmniverseAudioSegment& InSegment);
+	int64 GetFreeBytes() const;
+	void RecordFill();
+
+	TArray<uint8> Buffer;
+	uint64 Capacity = 0;
+
+	// Positions only grow, each one is written by a single thread and sits on its own cache line
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> WritePosition = 0;
+	// Producer only
+	TOptional<FOmniverseAudioSegment> PendingSegment;
+	std::atomic<int64> PeakFillBytes = 0;
+	std::atomic<int64> DroppedBytes = 0;
+	std::atomic<int64> NumOverflows = 0;
+
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> ReadPosition = 0;
+	// Consumer only, the bytes left in the sample record being read
+	uint32 RemainingSampleBytes = 0;
+};
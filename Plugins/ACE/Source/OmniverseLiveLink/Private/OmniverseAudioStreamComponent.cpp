@@ -0,0 +1,101 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "OmniverseAudioStreamComponent.h"
+#include "OmniverseWaveStreamer.h"
+#include "OmniverseSubmixListener.h"
+
+// Buffers rendered silent between the attempts to play a listener played by another generator
+#define GENERATOR_ATTACH_RETRY_BUFFERS 50
+
+namespace
+{
+	// Renders the streams of the source on the audio port, in place of its submix listener
+	class FOmniverseStreamGenerator : public ISoundGenerator
+	{
+	public:
+		FOmniverseStreamGenerator(uint32 InPort, const FSoundGeneratorInitParams& InParams)
+			: SampleRate(InParams.SampleRate)
+			, NumChannels(InParams.NumChannels)
+			, NumFramesPerCallback(InParams.NumFramesPerCallback)
+			, Binding(FOmniverseWaveStreamer::BindSubmixListener(InPort, SubmixListener))
+		{
+		}
+
+		virtual ~FOmniverseStreamGenerator()
+		{
+			if (SubmixListener.IsValid())
+			{
+				SubmixListener->DetachGenerator(this);
+			}
+		}
+
+		virtual int32 GetDesiredNumSamplesToRenderPerCallback() const override
+		{
+			return NumFramesPerCallback * NumChannels;
+		}
+
+		virtual int32 OnGenerateAudio(float* OutAudio, int32 NumSamples) override
+		{
+			FMemory::Memzero(OutAudio, NumSamples * sizeof(float));
+
+			// The source may be created after the component, or replaced, it offers its listener to the binding
+			FOmniverseSubmixListener* PreviousListener = SubmixListener.Get();
+			if (Binding->Take(SubmixListener) && PreviousListener)
+			{
+				PreviousListener->DetachGenerator(this);
+			}
+
+			if (!SubmixListener.IsValid() || !Attach())
+			{
+				return NumSamples;
+			}
+
+			const int32 RenderSamples = FMath::Min(NumSamples, SubmixListener->GetMaxBufferFrames() * NumChannels);
+			SubmixListener->Render(OutAudio, RenderSamples, NumChannels, SampleRate);
+			return NumSamples;
+		}
+
+	private:
+		bool Attach()
+		{
+			if (SubmixListener->IsGeneratorAttached(this))
+			{
+				return true;
+			}
+
+			// The listener may be played by another component now
+			if (AttachRetryBuffers-- > 0)
+			{
+				return false;
+			}
+			AttachRetryBuffers = GENERATOR_ATTACH_RETRY_BUFFERS;
+			return SubmixListener->AttachGenerator(this);
+		}
+
+		int32 SampleRate;
+		int32 NumChannels;
+		int32 NumFramesPerCallback;
+		int32 AttachRetryBuffers = 0;
+		// Audio render thread only, the listener it replaces goes back to the binding and is released by the next offer
+		TSharedPtr<FOmniverseSubmixListener, ESPMode::ThreadSafe> SubmixListener;
+		TSharedRef<FOmniverseSubmixListenerBinding, ESPMode::ThreadSafe> Binding;
+	};
+}
+
+bool UOmniverseAudioStreamComponent::Init(int32& SampleRate)
+{
+	// Mono, spatialized at the character
+	NumChannels = 1;
+	return true;
+}
+
+ISoundGeneratorPtr UOmniverseAudioStreamComponent::CreateSoundGenerator(const FSoundGeneratorInitParams& InParams)
+{
+	return ISoundGeneratorPtr(new FOmniverseStreamGenerator(AudioPort, InParams));
+}
@@ -7,37 +7,85 @@
 // license agreement from NVIDIA CORPORATION is strictly prohibited.
 
 #include "OmniverseBaseListener.h"
+#include "ACEPrivate.h"
 #include "OmniverseLiveLinkFramePlayer.h"
 #include "Async/Async.h"
 #include "Common/TcpSocketBuilder.h"
 #include "Common/TcpListener.h"
+#include "HAL/IConsoleManager.h"
 #include "HAL/RunnableThread.h"
 #include "ILiveLinkClient.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+#include "OmniverseRenderCheck.h"
+#include "BSDSockets/SocketsBSD.h"
+#include <atomic>
+#if !PLATFORM_WINDOWS
+#include <poll.h>
+#endif
 
 #define RECV_BUFFER_SIZE 1024 * 1024
-#define RECV_HEADER_SIZE 8
-
-
-static int32 BytesToInt(uint8* Bytes, int32 Length)
+// Minimal free space of the framer buffer for each receive
+#define RECV_MIN_FREE_SIZE 64 * 1024
+// Upper bound of a blocking socket wait, the socket thread checks whether it's stopped at least this often
+#define SOCKET_WAIT_TIME_MS 100
+#define MAX_CONNECTIONS 16
+
+#if PLATFORM_WINDOWS
+typedef WSAPOLLFD FOmniversePollSocket;
+#define OMNIVERSE_POLL_READ POLLRDNORM
+#define OmniversePoll WSAPoll
+#else
+typedef pollfd FOmniversePollSocket;
+#define OMNIVERSE_POLL_READ POLLIN
+#define OmniversePoll poll
+#endif
+
+
+static TAutoConsoleVariable<int32> CVarOmniverseMaxPackageSize(
+	TEXT("omni.MaxPackageSize"),
+	16,
+	TEXT("The maximum size of a received package in MB (default is 16). The connection is closed if a package header exceeds it.\n"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarOmniverseCaptureStreams(
+	TEXT("omni.CaptureStreams"),
+	0,
+	TEXT("1 records every package received by the sources, with its receive time and connection, to Saved/ACECaptures/Port<port>_<time>.ovcap (default is 0).\n")
+	TEXT("Replayed by simple_socket_sender.py --capture-file.\n"),
+	ECVF_Default);
+
+// omni.CaptureStreams for the socket threads, updated by the sink on the game thread
+static std::atomic<bool> GOmniverseCaptureStreams = false;
+
+static void OnCaptureStreamsChanged()
 {
-	int32 Return = 0;
-	int32 Flag = 0;
-	for (int32 Index = Length - 1; Index >= 0; --Index)
-	{
-		Return += (Bytes[Index] & 0xFF) << (8 * Flag);
-		++Flag;
-	}
-	return Return;
+	GOmniverseCaptureStreams.store(CVarOmniverseCaptureStreams.GetValueOnGameThread() != 0, std::memory_order_relaxed);
 }
 
+static FAutoConsoleVariableSink CVarOmniverseCaptureStreamsSink(FConsoleCommandDelegate::CreateStatic(&OnCaptureStreamsChanged));
+
+static TAutoConsoleVariable<int32> CVarOmniverseCaptureBufferSize(
+	TEXT("omni.CaptureBufferSize"),
+	16,
+	TEXT("The size of the buffer of each capture in MB (default is 16). The packages are dropped when the writer can't keep up.\n"),
+	ECVF_Default);
+
 const FString FOmniverseBaseListener::HeaderSeparator = TEXT(":");
 
+FOmniverseBaseListener::FConnection::FConnection(uint32 InId, FSocket* InSocket, int32 InMaxPackageSize)
+	: Id(InId)
+	, Socket(InSocket)
+	, Framer(RECV_BUFFER_SIZE, InMaxPackageSize)
+{
+}
+
 FOmniverseBaseListener::FOmniverseBaseListener(uint32 InPort)
 	: ListenerSocket(nullptr)
-	, ConnectionSocket(nullptr)
 	, SocketSubsystem(nullptr)
 	, SocketThread(nullptr)
 	, ThreadStopping(false)
+	, ListenPort(InPort)
 {
 	// Create Listener Socket
 	ListenerSocket = FTcpSocketBuilder(TEXT("OmniverseLiveLink"))
@@ -47,7 +95,6 @@ FOmniverseBaseListener::FOmniverseBaseListener(uint32 InPort)
 		.Listening(8)
 		.WithReceiveBufferSize(RECV_BUFFER_SIZE);
 
-	RecvBuffer.SetNumUninitialized(RECV_BUFFER_SIZE);
 	if (ListenerSocket != nullptr)
 	{
 		SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
@@ -68,11 +115,11 @@ FOmniverseBaseListener::~FOmniverseBaseListener()
 		ListenerSocket->Close();
 		SocketSubsystem->DestroySocket(ListenerSocket);
 	}
-	if (ConnectionSocket)
+	while (Connections.Num() > 0)
 	{
-		ConnectionSocket->Close();
-		SocketSubsystem->DestroySocket(ConnectionSocket);
+		CloseConnection(Connections.Num() - 1);
 	}
+	Recorder.Reset();
 
 	LiveLinkClient = nullptr;
 	SourceGuid.Invalidate();
@@ -92,6 +139,122 @@ void FOmniverseBaseListener::Start()
 void FOmniverseBaseListener::Stop()
 {
 	ThreadStopping = true;
+
+	// Wake up the socket thread blocked in waiting for data, the sockets shut down are readable
+	FOmniverseScopeLock Lock(&ConnectionLock);
+	for (const TUniquePtr<FConnection>& Connection : Connections)
+	{
+		Connection->Socket->Shutdown(ESocketShutdownMode::Read);
+	}
+}
+
+void FOmniverseBaseListener::AcceptConnection(FInternetAddr& RemoteAddr)
+{
+	FSocket* NewSocket = ListenerSocket->Accept(RemoteAddr, TEXT("OmniverseLiveLink Received Socket Connection"));
+	if (NewSocket == nullptr)
+	{
+		return;
+	}
+
+	if (Connections.Num() >= MAX_CONNECTIONS)
+	{
+		UE_LOG(LogACE, Warning, TEXT("Too many connections, refused %s."), *RemoteAddr.ToString(true));
+		NewSocket->Close();
+		SocketSubsystem->DestroySocket(NewSocket);
+		return;
+	}
+
+	const int32 MaxPackageSize = FMath::Clamp(CVarOmniverseMaxPackageSize.GetValueOnAnyThread(), 1, 1024) * 1024 * 1024;
+
+	FOmniverseScopeLock Lock(&ConnectionLock);
+	Connections.Add(MakeUnique<FConnection>(NextConnectionId++, NewSocket, MaxPackageSize));
+	UE_LOG(LogACE, Log, TEXT("Connection %u from %s, %d open."), Connections.Last()->Id, *RemoteAddr.ToString(true), Connections.Num());
+}
+
+void FOmniverseBaseListener::CloseConnection(int32 ConnectionIndex)
+{
+	const uint32 ConnectionId = Connections[ConnectionIndex]->Id;
+	{
+		FOmniverseScopeLock Lock(&ConnectionLock);
+		FSocket* Socket = Connections[ConnectionIndex]->Socket;
+		Socket->Close();
+		SocketSubsystem->DestroySocket(Socket);
+		Connections.RemoveAt(ConnectionIndex);
+	}
+
+	OnConnectionClosed(ConnectionId);
+}
+
+bool FOmniverseBaseListener::ReceiveIntoFramer(FConnection& Connection)
+{
+	int32 FreeSize = 0;
+	uint8* WriteBuffer = Connection.Framer.GetWriteBuffer(RECV_MIN_FREE_SIZE, FreeSize);
+
+	int32 ReadSize = 0;
+	if (!Connection.Socket->Recv(WriteBuffer, FreeSize, ReadSize) || ReadSize <= 0)
+	{
+		return false;
+	}
+
+	Connection.Framer.CommitWrite(ReadSize);
+	return ProcessFramedPackages(Connection);
+}
+
+void FOmniverseBaseListener::WaitForReadableSockets(bool& bOutPendingConnection)
+{
+	// One poll over the native handles of the listener and of every connection, so no thread blocks per socket
+	FOmniversePollSocket PollSockets[MAX_CONNECTIONS + 1];
+	const int32 NumSockets = Connections.Num() + 1;
+	for (int32 Index = 0; Index < NumSockets; ++Index)
+	{
+		FSocket* Socket = Index == 0 ? ListenerSocket : Connections[Index - 1]->Socket;
+		PollSockets[Index].fd = static_cast<FSocketBSD*>(Socket)->GetNativeSocket();
+		PollSockets[Index].events = OMNIVERSE_POLL_READ;
+		PollSockets[Index].revents = 0;
+	}
+
+	const int32 NumReady = OmniversePoll(PollSockets, NumSockets, SOCKET_WAIT_TIME_MS);
+	if (NumReady < 0)
+	{
+		// The poll failed, check each socket without blocking instead
+		bOutPendingConnection = false;
+		ListenerSocket->HasPendingConnection(bOutPendingConnection);
+		for (const TUniquePtr<FConnection>& Connection : Connections)
+		{
+			Connection->bReadable = Connection->Socket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::Zero());
+		}
+		return;
+	}
+
+	// A listener is readable with a connection to accept
+	bOutPendingConnection = (PollSockets[0].revents & OMNIVERSE_POLL_READ) != 0;
+	for (int32 Index = 1; Index < NumSockets; ++Index)
+	{
+		// A peer gone or a socket in error is readable too, the receive finds it closed
+		Connections[Index - 1]->bReadable = (PollSockets[Index].revents & (OMNIVERSE_POLL_READ | POLLHUP | POLLERR | POLLNVAL)) != 0;
+	}
+}
+
+bool FOmniverseBaseListener::ReceivePendingData(FConnection& Connection)
+{
+	// The socket is readable, so the first Recv doesn't block. 
+	// Nothing to read means the peer closed the connection (or Stop() shut it down).
+	if (!ReceiveIntoFramer(Connection))
+	{
+		return false;
+	}
+
+	// Drain the rest without waiting again
+	uint32 PendingSize = 0;
+	while (!ThreadStopping && Connection.Socket->HasPendingData(PendingSize) && PendingSize > 0)
+	{
+		if (!ReceiveIntoFramer(Connection))
+		{
+			return false;
+		}
+	}
+
+	return true;
 }
 
 uint32 FOmniverseBaseListener::Run()
@@ -99,46 +262,24 @@ uint32 FOmniverseBaseListener::Run()
 	TSharedRef<FInternetAddr> RemoteAddr = SocketSubsystem->CreateInternetAddr();
 	while (!ThreadStopping)
 	{
-		bool bPending = false;
-		if (ListenerSocket->HasPendingConnection(bPending) && bPending)
+		UpdateCapture();
+
+		// Sleep until a sender connects, any connection is readable, its peer disconnects or Stop() shuts the sockets down
+		bool bPendingConnection = false;
+		WaitForReadableSockets(bPendingConnection);
+
+		for (int32 Index = Connections.Num() - 1; Index >= 0; --Index)
 		{
-			// Already have a Connection? destroy previous
-			if (ConnectionSocket)
+			FConnection& Connection = *Connections[Index];
+			if (Connection.bReadable && !ReceivePendingData(Connection))
 			{
-				ConnectionSocket->Close();
-				SocketSubsystem->DestroySocket(ConnectionSocket);
+				CloseConnection(Index);
 			}
-			// New Connection receive!
-			ConnectionSocket = ListenerSocket->Accept(*RemoteAddr, TEXT("OmniverseLiveLink Received Socket Connection"));
 		}
 
-		if (ConnectionSocket)
+		if (!ThreadStopping && bPendingConnection)
 		{
-			double CurrentRecvTime = FPlatformTime::Seconds();
-			uint32 PendingSize = 0;
-			while (ConnectionSocket->HasPendingData(PendingSize))
-			{
-				int32 ReadSize = 0;
-				if (ConnectionSocket->Recv(RecvBuffer.GetData(), RecvBuffer.Num(), ReadSize))
-				{
-					if (ReadSize > 0)
-					{
-						OnRawDataReceived(RecvBuffer.GetData(), ReadSize);
-					}
-				}
-			}
-
-			////const double TimeOutSeconds = CVarOmniverseLiveLinkTimeOutSeconds.GetValueOnAnyThread();
-			////// Ping remote address to see if the socket was closed
-			////// NOTE: we can't use ConnectionSocket->GetConnectionState() to get the correct state of socket
-			////// https://forums.unrealengine.com/t/fsocket-getconnectionstate-always-returns-true/345349
-			////// https://issues.unrealengine.com/issue/UE-27542
-			////if (TimeOutSeconds > 0.0 && (CurrentRecvTime - LastRecvTime > TimeOutSeconds))
-			////{
-			////	ConnectionSocket->Close();
-			////	SocketSubsystem->DestroySocket(ConnectionSocket);
-			////	ConnectionSocket = nullptr;
-			////}
+			AcceptConnection(*RemoteAddr);
 		}
 	}
 	return 0;
@@ -166,15 +307,93 @@ bool FOmniverseBaseListener::IsEOSPackage(const uint8* InPackageData, int32 InPa
 	return bEndOfSteam;
 }
 
-void FOmniverseBaseListener::PushPackageData(const uint8* InPackageData, int32 InPackageSize)
+bool FOmniverseBaseListener::IsInterruptPackage(const uint8* InPackageData, int32 InPackageSize) const
+{
+	const char MagicWord[] = { 'I', 'N', 'T' };
+
+	const int32 MagicSize = sizeof(MagicWord) / sizeof(MagicWord[0]);
+
+	return InPackageSize == MagicSize && FMemory::Memcmp(InPackageData, MagicWord, MagicSize) == 0;
+}
+
+void FOmniverseBaseListener::OnInterrupt()
+{
+	bInterruptPending = true;
+}
+
+void FOmniverseBaseListener::Interrupt()
+{
+	UE_LOG(LogACE, Log, TEXT("Interrupted, the streams in flight are dropped."));
+	if (FramePlayer)
+	{
+		// Both listeners of the source, the audio and the animation stop together
+		FramePlayer->Interrupt();
+	}
+	else
+	{
+		OnInterrupt();
+	}
+	ApplyPendingInterrupt();
+}
+
+void FOmniverseBaseListener::ApplyPendingInterrupt()
+{
+	if (!bInterruptPending)
+	{
+		return;
+	}
+	bInterruptPending = false;
+
+	// The packages of a connection not in a stream aren't queued, they keep playing as they arrive
+	for (const TUniquePtr<FConnection>& Connection : Connections)
+	{
+		Connection->bInterrupted = Connection->bInBurst;
+		Connection->bInBurst = false;
+		Connection->CustomDeltaTime.Reset();
+		Connection->LastPushTime.Reset();
+		Connection->LastPackageDuration.Reset();
+	}
+}
+
+void FOmniverseBaseListener::PushPackageData(FConnection& Connection, const uint8* InPackageData, int32 InPackageSize)
 {
+	ApplyPendingInterrupt();
+
+	// Checked before decoding, it's sent as text on a connection of any format
+	if (IsInterruptPackage(InPackageData, InPackageSize))
+	{
+		Interrupt();
+		return;
+	}
+
+	// The rest of an interrupted stream isn't even decoded, the next header starts a new one
+	if (Connection.bInterrupted && !IsHeaderPackage(InPackageData, InPackageSize))
+	{
+		if (IsEOSPackage(InPackageData, InPackageSize))
+		{
+			Connection.bInterrupted = false;
+		}
+		return;
+	}
+	Connection.bInterrupted = false;
+
+	if (!DecodePackage(InPackageData, InPackageSize, Connection.Id))
+	{
+		return;
+	}
+
+	TOptional<double>& CustomDeltaTime = Connection.CustomDeltaTime;
+	TOptional<double>& LastPushTime = Connection.LastPushTime;
+	bool& bInBurst = Connection.bInBurst;
+
 	double CurrentTime = FPlatformTime::Seconds();
 	if (IsEOSPackage(InPackageData, InPackageSize))
 	{
 		CustomDeltaTime.Reset();
 		LastPushTime.Reset();
+		Connection.LastPackageDuration.Reset();
 		bInBurst = false;
-		OnPackageDataPushed(InPackageData, InPackageSize, 0.0, false, true);
+		OnPackageDataPushed(InPackageData, InPackageSize, Connection.Id, 0.0, false, true);
 		return;
 	}
 
@@ -190,8 +409,9 @@ void FOmniverseBaseListener::PushPackageData(const uint8* InPackageData, int32 I
 			CustomDeltaTime.Reset();
 		}
 		LastPushTime.Reset();
+		Connection.LastPackageDuration.Reset();
 		bInBurst = true;
-		OnPackageDataPushed(InPackageData, InPackageSize, 0.0, true);
+		OnPackageDataPushed(InPackageData, InPackageSize, Connection.Id, 0.0, true);
 		return;
 	}
 
@@ -200,7 +420,19 @@ void FOmniverseBaseListener::PushPackageData(const uint8* InPackageData, int32 I
 		double DeltaTime = 0.0;
 		if (LastPushTime.IsSet())
 		{
-			DeltaTime = CustomDeltaTime.IsSet() ? CustomDeltaTime.GetValue() : (CurrentTime - LastPushTime.GetValue());
+			// The package is due when the previous one has played, the arrival gap is the last resort
+			if (CustomDeltaTime.IsSet())
+			{
+				DeltaTime = CustomDeltaTime.GetValue();
+			}
+			else if (Connection.LastPackageDuration.IsSet())
+			{
+				DeltaTime = Connection.LastPackageDuration.GetValue();
+			}
+			else
+			{
+				DeltaTime = CurrentTime - LastPushTime.GetValue();
+			}
 		}
 		else
 		{
@@ -208,68 +440,98 @@ void FOmniverseBaseListener::PushPackageData(const uint8* InPackageData, int32 I
 			DeltaTime = (double)GetDelayTime() / 1000.0;
 		}
 
-		OnPackageDataPushed(InPackageData, InPackageSize, DeltaTime);
+		OnPackageDataPushed(InPackageData, InPackageSize, Connection.Id, DeltaTime);
 		LastPushTime = CurrentTime;
+
+		double Duration = 0.0;
+		if (GetPackageDuration(InPackageData, InPackageSize, Connection.Id, Duration))
+		{
+			Connection.LastPackageDuration = Duration;
+		}
+		else
+		{
+			Connection.LastPackageDuration.Reset();
+		}
 	}
 	else
 	{
-		OnPackageDataReceived(InPackageData, InPackageSize);
+		OnPackageDataReceived(InPackageData, InPackageSize, Connection.Id);
 	}
 }
 
-void FOmniverseBaseListener::OnRawDataReceived(const uint8* InReceivedData, int32 InReceivedSize)
+void FOmniverseBaseListener::UpdateCapture()
 {
-	TArray<uint8> ReceivedData;
-	ReceivedData.Append(IncompleteData);
-	ReceivedData.Append(InReceivedData, InReceivedSize);
-	int ReceivedSize = ReceivedData.Num();
-
-	IncompleteData.Empty();
+	const bool bCapture = GOmniverseCaptureStreams.load(std::memory_order_relaxed);
+	if (!bCapture)
+	{
+		bCaptureFailed = false;
+		if (Recorder)
+		{
+			// The writer thread finishes the file off the socket thread
+			Async(EAsyncExecution::ThreadPool, [ClosingRecorder = MoveTemp(Recorder)]() mutable { ClosingRecorder.Reset(); });
+		}
+		return;
+	}
 
-	while (true)
+	if (!Recorder && !bCaptureFailed)
 	{
-		if (!DataSizeInHeader.IsSet())
+		const FString FileName = FPaths::ProjectSavedDir() / TEXT("ACECaptures") / FString::Printf(TEXT("Port%u_%s.ovcap"), ListenPort, *FDateTime::Now().ToString());
+		const int32 BufferSize = FMath::Clamp(CVarOmniverseCaptureBufferSize.GetValueOnAnyThread(), 1, 1024) * 1024 * 1024;
+		Recorder = MakeUnique<FOmniverseCaptureRecorder>(ListenPort, BufferSize);
+		if (!Recorder->Start(FileName))
+		{
+			// Not retried until the capture is set again
+			Recorder.Reset();
+			bCaptureFailed = true;
+			return;
+		}
+
+		// The streams in flight are replayable from their next package on
+		const double StartTime = FPlatformTime::Seconds();
+		for (const TUniquePtr<FConnection>& Connection : Connections)
 		{
-			if (ReceivedSize < RECV_HEADER_SIZE)
+			if (Connection->StreamHeader.Num() > 0)
 			{
-				//UE_LOG(LogACE, Warning, TEXT("Incomplete Data: %d"), ReceivedSize);
-				IncompleteData = ReceivedData;
-				break;
+				Recorder->Record(Connection->Id, StartTime, Connection->StreamHeader.GetData(), Connection->StreamHeader.Num());
 			}
-
-			DataSizeInHeader = BytesToInt(ReceivedData.GetData(), RECV_HEADER_SIZE);
-			ReceivedData.RemoveAt(0, RECV_HEADER_SIZE);
-			ReceivedSize = ReceivedData.Num();
 		}
-		// This's the complete package, ready to parse 
-		else if (ReceivedSize == DataSizeInHeader.GetValue())
-		{
-			PushPackageData(ReceivedData.GetData(), ReceivedSize);
-			DataSizeInHeader.Reset();
+	}
+}
 
-			//UE_LOG(LogACE, Warning, TEXT("Complete package, ready to parse: %d, %d"), ReceivedSize, ReceivedData.Num());
-			break;
-		}
-		// This's the incomplete data, need to be completed next time
-		else if (ReceivedSize < DataSizeInHeader.GetValue())
+bool FOmniverseBaseListener::ProcessFramedPackages(FConnection& Connection)
+{
+	// The packages framed from the same receive share its time
+	const double ReceiveTime = FPlatformTime::Seconds();
+	const uint8* PackageData = nullptr;
+	int32 PackageSize = 0;
+	while (Connection.Framer.NextPackage(PackageData, PackageSize))
+	{
+		// Kept as it's received, before decoding, the capture holds the raw packages
+		if (IsHeaderPackage(PackageData, PackageSize))
 		{
-			IncompleteData = ReceivedData;
-
-			//UE_LOG(LogACE, Warning, TEXT("Incomplete package, complete next time: %d, %d"), ReceivedSize, ReceivedData.Num());
-			break;
+			Connection.StreamHeader.SetNumUninitialized(PackageSize, false);
+			FMemory::Memcpy(Connection.StreamHeader.GetData(), PackageData, PackageSize);
 		}
-		// This's mixing data, need to be separated
-		else if (ReceivedSize > DataSizeInHeader.GetValue())
+		else if (IsEOSPackage(PackageData, PackageSize))
 		{
-			int32 DataSize = DataSizeInHeader.GetValue();
-			PushPackageData(ReceivedData.GetData(), DataSize);
-			ReceivedData.RemoveAt(0, DataSize);
-			ReceivedSize = ReceivedData.Num();
-			DataSizeInHeader.Reset();
+			Connection.StreamHeader.Reset();
+		}
 
-			//UE_LOG(LogACE, Warning, TEXT("Mixing data, need to be separated: %d, %d"), ReceivedSize, ReceivedData.Num());
+		if (Recorder)
+		{
+			Recorder->Record(Connection.Id, ReceiveTime, PackageData, PackageSize);
 		}
+		PushPackageData(Connection, PackageData, PackageSize);
+	}
+
+	if (Connection.Framer.HasError())
+	{
+		// Can't find the next package boundary in a corrupted stream
+		UE_LOG(LogACE, Error, TEXT("Invalid package size in header, dropping connection %u."), Connection.Id);
+		return false;
 	}
+
+	return true;
 }
 
 bool FOmniverseBaseListener::IsSocketReady() const
@@ -288,3 +550,8 @@ void FOmniverseBaseListener::SetClient(ILiveLinkClient* InClient, FGuid InSource
 	LiveLinkClient = InClient;
 	SourceGuid = InSourceGuid;
 }
+
+void FOmniverseBaseListener::SetFramePlayer(TSharedPtr<FOmniverseLiveLinkFramePlayer, ESPMode::ThreadSafe> InFramePlayer)
+{
+	FramePlayer = InFramePlayer;
+}
@@ -8,10 +8,13 @@
 
 #pragma once
 #include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
 #include "HAL/Runnable.h"
 #include "HAL/ThreadSafeBool.h"
 #include "ILiveLinkClient.h"
 #include "OmniverseLiveLinkFramePlayer.h"
+#include "OmniversePackageFramer.h"
+#include "OmniverseCaptureRecorder.h"
 
 
 class FOmniverseBaseListener : public FRunnable
@@ -28,20 +31,32 @@ public:
 	virtual void Start();
 	virtual bool IsValid() const;
 	virtual bool IsSocketReady() const;
-	// Get the raw data from network
-	virtual void OnRawDataReceived(const uint8* InReceivedData, int32 InReceivedSize);
 	// Get the size-checked package
-	virtual void OnPackageDataReceived(const uint8* InPackageData, int32 InPackageSize) {};
-	virtual void OnPackageDataPushed(const uint8* InPackageData, int32 InPackageSize, double DeltaTime, bool bBegin = false, bool bEnd = false) {};
+	virtual void OnPackageDataReceived(const uint8* InPackageData, int32 InPackageSize, uint32 InConnectionId) {};
+	virtual void OnPackageDataPushed(const uint8* InPackageData, int32 InPackageSize, uint32 InConnectionId, double DeltaTime, bool bBegin = false, bool bEnd = false) {};
+	// Socket thread: the package of the connection as it's pushed or received, e.g. decoded. False drops it
+	virtual bool DecodePackage(const uint8*& InOutPackageData, int32& InOutPackageSize, uint32 InConnectionId) { return true; }
+	// The sender of the connection is gone, called in socket thread
+	virtual void OnConnectionClosed(uint32 InConnectionId) {};
 	virtual uint32 GetDelayTime() const { return 0; }
+	// Position of the stream being played by the device, the clock the animation is synced to
+	virtual bool GetPlaybackPosition(double& OutPosition, double& OutStreamStartTime) const { return false; }
 
 	virtual bool IsEOSPackage(const uint8* InPackageData, int32 InPackageSize) const;
+	// "INT" on any connection interrupts the source, its streams in flight stop
+	virtual bool IsInterruptPackage(const uint8* InPackageData, int32 InPackageSize) const;
 	virtual bool IsHeaderPackage(const uint8* InPackageData, int32 InPackageSize) const { return false; }
 	virtual bool GetFPSInHeader(const uint8* InPackageData, int32 InPackageSize, double& OutFPS) const { return false; }
+	// Socket thread: play time of a decoded package of the stream, the pending time of the package after it
+	virtual bool GetPackageDuration(const uint8* InPackageData, int32 InPackageSize, uint32 InConnectionId, double& OutDuration) const { return false; }
+	// Any thread: flush the packages of the streams in flight, until the next header of their connection.
+	// Called by the frame player for both listeners of the source with its queues flushed
+	virtual void OnInterrupt();
 
 	// End FOmniverseBaseListener Interface
 
 	void SetClient(class ILiveLinkClient* InClient, FGuid InSourceGuid);
+	void SetFramePlayer(TSharedPtr<FOmniverseLiveLinkFramePlayer, ESPMode::ThreadSafe> InFramePlayer);
 protected:
 	// Begin FRunnable Interface
 	virtual bool Init() override { return true; }
@@ -53,29 +68,68 @@ protected:
 	class ILiveLinkClient* LiveLinkClient = nullptr;
 	// Source GUID in LiveLink
 	FGuid SourceGuid;
+	// Timeline of the source the pushed packages are played in
+	TSharedPtr<FOmniverseLiveLinkFramePlayer, ESPMode::ThreadSafe> FramePlayer;
 
 	const static FString HeaderSeparator;
 
 private:
-	void PushPackageData(const uint8* InPackageData, int32 InPackageSize);
+	// One sender, with its own framing and burst state
+	struct FConnection
+	{
+		FConnection(uint32 InId, class FSocket* InSocket, int32 InMaxPackageSize);
+
+		uint32 Id;
+		class FSocket* Socket;
+		// Set by the last wait: data to receive, or the peer is gone
+		bool bReadable = false;
+
+		// Buffer to receive socket data into
+		FOmniversePackageFramer Framer;
+
+		TOptional<double> CustomDeltaTime;
+		TOptional<double> LastPushTime;
+		// Play time of the last pushed package, when the stream has no FPS
+		TOptional<double> LastPackageDuration;
+		bool bInBurst = false;
+		// The stream was interrupted, its packages are dropped until the next header
+		bool bInterrupted = false;
+		// Header of the stream in flight, recorded first by a capture started in the middle of it
+		TArray<uint8> StreamHeader;
+	};
+
+	void PushPackageData(FConnection& Connection, const uint8* InPackageData, int32 InPackageSize);
+	// Socket thread: the interrupt of the source, and the one requested by the other listener
+	void Interrupt();
+	void ApplyPendingInterrupt();
+	void AcceptConnection(class FInternetAddr& RemoteAddr);
+	void CloseConnection(int32 ConnectionIndex);
+	// Socket thread: sleeps until a sender connects or any connection is readable, at most SOCKET_WAIT_TIME_MS
+	void WaitForReadableSockets(bool& bOutPendingConnection);
+	bool ReceivePendingData(FConnection& Connection);
+	bool ReceiveIntoFramer(FConnection& Connection);
+	bool ProcessFramedPackages(FConnection& Connection);
+	// Socket thread: starts or stops the recorder as omni.CaptureStreams is set, checked each time the thread wakes
+	void UpdateCapture();
 
 	// Tcp Server
 	class FSocket* ListenerSocket;
-	class FSocket* ConnectionSocket;
 	class ISocketSubsystem* SocketSubsystem;
 	// Thread to run socket operations on
 	class FRunnableThread* SocketThread;
 
 	// Threadsafe Bool for terminating the main thread loop
 	FThreadSafeBool ThreadStopping;
+	// Guard Connections between socket thread and Stop()
+	FCriticalSection ConnectionLock;
+	// Set by OnInterrupt(), the burst state of the connections is flushed before the next package
+	FThreadSafeBool bInterruptPending = false;
 
-	// Buffer to receive socket data into
-	// Only in socket thread
-	TArray<uint8> RecvBuffer;
-	TArray<uint8> IncompleteData;
-	TOptional<int32> DataSizeInHeader;
-
-	TOptional<double> CustomDeltaTime;
-	TOptional<double> LastPushTime;
-	bool bInBurst = false;
+	// Only modified in socket thread
+	TArray<TUniquePtr<FConnection>> Connections;
+	uint32 NextConnectionId = 1;
+	uint32 ListenPort = 0;
+	// Every framed package while omni.CaptureStreams is set, socket thread only
+	TUniquePtr<FOmniverseCaptureRecorder> Recorder;
+	bool bCaptureFailed = false;
 };
@@ -0,0 +1,153 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "OmniverseCaptureRecorder.h"
+#include "ACEPrivate.h"
+#include "Async/Async.h"
+#include "HAL/Event.h"
+#include "HAL/FileManager.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/DateTime.h"
+
+// The writer appends the ring at least this often, or once it's a quarter full
+#define CAPTURE_WRITE_INTERVAL_MS 50
+
+
+FOmniverseCaptureRecorder::FOmniverseCaptureRecorder(uint32 InPort, int32 InBufferCapacity)
+	: Port(InPort)
+{
+	Capacity = FMath::RoundUpToPowerOfTwo(FMath::Max(InBufferCapacity, 64 * 1024));
+	Buffer.SetNumUninitialized(Capacity);
+	WakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+}
+
+FOmniverseCaptureRecorder::~FOmniverseCaptureRecorder()
+{
+	Stop();
+
+	// The thread writes what is left before it exits
+	if (Thread)
+	{
+		Thread->WaitForCompletion();
+		delete Thread;
+	}
+
+	if (FileWriter)
+	{
+		FileWriter->Close();
+		UE_LOG(LogACE, Log, TEXT("Capture of port %u closed, %lld packages dropped: %s"), Port, GetNumDroppedPackages(), *FileName);
+	}
+
+	FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+	WakeEvent = nullptr;
+}
+
+bool FOmniverseCaptureRecorder::Start(const FString& InFileName)
+{
+	FileWriter.Reset(IFileManager::Get().CreateFileWriter(*InFileName));
+	if (!FileWriter)
+	{
+		UE_LOG(LogACE, Warning, TEXT("Can't create the capture file %s"), *InFileName);
+		return false;
+	}
+	FileName = InFileName;
+
+	FOmniverseCaptureFileHeader Header;
+	Header.Port = Port;
+	Header.StartTime = FPlatformTime::Seconds();
+	Header.StartUtcTicks = FDateTime::UtcNow().GetTicks();
+	FileWriter->Serialize(&Header, sizeof(Header));
+	StartTime = Header.StartTime;
+
+	FString ThreadName = TEXT("Omniverse LiveLink Capture ");
+	ThreadName.AppendInt(FAsyncThreadIndex::GetNext());
+	Thread = FRunnableThread::Create(this, *ThreadName, 64 * 1024, TPri_BelowNormal, FPlatformAffinity::GetPoolThreadMask());
+
+	UE_LOG(LogACE, Log, TEXT("Capturing port %u to %s"), Port, *FileName);
+	return Thread != nullptr;
+}
+
+void FOmniverseCaptureRecorder::Stop()
+{
+	ThreadStopping = true;
+	if (WakeEvent)
+	{
+		WakeEvent->Trigger();
+	}
+}
+
+void FOmniverseCaptureRecorder::WriteBytes(uint64 InPosition, const void* InData, int32 InSize)
+{
+	const int32 Offset = (int32)(InPosition & (Capacity - 1));
+	const int32 FirstSize = FMath::Min(InSize, (int32)Capacity - Offset);
+	FMemory::Memcpy(Buffer.GetData() + Offset, InData, FirstSize);
+	FMemory::Memcpy(Buffer.GetData(), (const uint8*)InData + FirstSize, InSize - FirstSize);
+}
+
+void FOmniverseCaptureRecorder::Record(uint32 InConnectionId, double InReceiveTime, const uint8* InData, int32 InSize)
+{
+	if (InSize < 0)
+	{
+		return;
+	}
+
+	const uint64 Position = WritePosition.load(std::memory_order_relaxed);
+	const uint64 FillBytes = Position - ReadPosition.load(std::memory_order_acquire);
+	const uint64 RecordSize = sizeof(FOmniverseCaptureRecordHeader) + InSize;
+	if (FillBytes + RecordSize > Capacity)
+	{
+		// The writer can't keep up, the socket thread doesn't wait for it
+		NumDroppedPackages.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	FOmniverseCaptureRecordHeader Header;
+	Header.ReceiveTime = InReceiveTime - StartTime;
+	Header.ConnectionId = InConnectionId;
+	Header.Size = (uint32)InSize;
+	WriteBytes(Position, &Header, sizeof(Header));
+	WriteBytes(Position + sizeof(Header), InData, InSize);
+	WritePosition.store(Position + RecordSize, std::memory_order_release);
+
+	// Woken early when the ring fills up faster than the write interval
+	if (FillBytes < Capacity / 4 && FillBytes + RecordSize >= Capacity / 4)
+	{
+		WakeEvent->Trigger();
+	}
+}
+
+void FOmniverseCaptureRecorder::WritePending()
+{
+	const uint64 Position = ReadPosition.load(std::memory_order_relaxed);
+	const uint64 EndPosition = WritePosition.load(std::memory_order_acquire);
+	if (Position == EndPosition)
+	{
+		return;
+	}
+
+	// Up to the end of the buffer, then the wrapped part
+	const int32 Size = (int32)(EndPosition - Position);
+	const int32 Offset = (int32)(Position & (Capacity - 1));
+	const int32 FirstSize = FMath::Min(Size, (int32)Capacity - Offset);
+	FileWriter->Serialize(Buffer.GetData() + Offset, FirstSize);
+	FileWriter->Serialize(Buffer.GetData(), Size - FirstSize);
+	ReadPosition.store(EndPosition, std::memory_order_release);
+}
+
+uint32 FOmniverseCaptureRecorder::Run()
+{
+	while (!ThreadStopping)
+	{
+		WakeEvent->Wait(CAPTURE_WRITE_INTERVAL_MS);
+		WritePending();
+	}
+
+	WritePending();
+	FileWriter->Flush();
+	return 0;
+}
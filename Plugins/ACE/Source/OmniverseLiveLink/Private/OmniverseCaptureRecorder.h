@@ -0,0 +1,91 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeBool.h"
+#include <atomic>
+
+// Capture file, little endian and append only:
+// the file header, then for each framed package its record header and its bytes as they were received, before any decoding
+#define OMNIVERSE_CAPTURE_MAGIC 0x5043564F // "OVCP"
+#define OMNIVERSE_CAPTURE_VERSION 1
+
+#pragma pack(push, 1)
+struct FOmniverseCaptureFileHeader
+{
+	uint32 Magic = OMNIVERSE_CAPTURE_MAGIC;
+	uint32 Version = OMNIVERSE_CAPTURE_VERSION;
+	uint32 Port = 0;
+	// Platform time the receive times are relative to, and the UTC time of it in FDateTime ticks
+	double StartTime = 0.0;
+	int64 StartUtcTicks = 0;
+};
+
+struct FOmniverseCaptureRecordHeader
+{
+	// Seconds after the start of the capture the package was received
+	double ReceiveTime = 0.0;
+	// Stream of the package, the connection of the listener
+	uint32 ConnectionId = 0;
+	uint32 Size = 0;
+};
+#pragma pack(pop)
+
+// Records the packages of a listener to a capture file, for the field issues to be replayed offline.
+// The socket thread copies each package into a fixed capacity ring, never waiting: the packages which don't fit are
+// dropped and counted. A writer thread of its own appends the ring to the file
+class FOmniverseCaptureRecorder : public FRunnable
+{
+public:
+	FOmniverseCaptureRecorder(uint32 InPort, int32 InBufferCapacity);
+	virtual ~FOmniverseCaptureRecorder();
+
+	// Creates the file and the writer thread, false if the file can't be written
+	bool Start(const FString& InFileName);
+
+	// Socket thread: a framed package of the connection, received at the platform time InReceiveTime
+	void Record(uint32 InConnectionId, double InReceiveTime, const uint8* InData, int32 InSize);
+
+	const FString& GetFileName() const { return FileName; }
+	int64 GetNumDroppedPackages() const { return NumDroppedPackages.load(std::memory_order_relaxed); }
+
+	// Begin FRunnable Interface
+	virtual void Stop() override;
+	// End FRunnable Interface
+
+protected:
+	// Begin FRunnable Interface
+	virtual bool Init() override { return true; }
+	virtual uint32 Run() override;
+	virtual void Exit() override {}
+	// End FRunnable Interface
+
+private:
+	// Writer thread: the records published so far to the file
+	void WritePending();
+	void WriteBytes(uint64 InPosition, const void* InData, int32 InSize);
+
+	uint32 Port;
+	FString FileName;
+	double StartTime = 0.0;
+	TUniquePtr<FArchive> FileWriter;
+
+	TArray<uint8> Buffer;
+	uint64 Capacity = 0;
+	// Written by the socket thread, whole records only
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> WritePosition = 0;
+	std::atomic<int64> NumDroppedPackages = 0;
+	// Written by the writer thread once the bytes are in the file
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> ReadPosition = 0;
+
+	class FRunnableThread* Thread = nullptr;
+	class FEvent* WakeEvent = nullptr;
+	FThreadSafeBool ThreadStopping = false;
+};
@@ -0,0 +1,105 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "OmniverseFrameInterpolator.h"
+#include "OmniverseRenderCheck.h"
+
+// Frames further apart are a pause of the stream, not blended
+#define MAX_INTERPOLATION_PERIOD_SECONDS 0.1
+
+void FOmniverseFrameInterpolator::AddFrame(const FName& InSubjectName, FLiveLinkAnimationFrameData&& InFrame, double InTime)
+{
+	FOmniverseScopeLock ScopeLock(&Lock);
+	FSubjectFrames& Frames = Subjects.FindOrAdd(InSubjectName);
+	if (Frames.NextTime > 0.0)
+	{
+		// The buffers of the previous frame are reused by the moved frame
+		Swap(Frames.Previous, Frames.Next);
+		Frames.PreviousTime = Frames.NextTime;
+		Frames.bHasPrevious = true;
+	}
+	Frames.Next = MoveTemp(InFrame);
+	Frames.NextTime = InTime;
+	Frames.bHeld = false;
+}
+
+void FOmniverseFrameInterpolator::ResetSubject(const FName& InSubjectName)
+{
+	FOmniverseScopeLock ScopeLock(&Lock);
+	Subjects.Remove(InSubjectName);
+}
+
+void FOmniverseFrameInterpolator::ResetAll()
+{
+	FOmniverseScopeLock ScopeLock(&Lock);
+	Subjects.Empty();
+}
+
+void FOmniverseFrameInterpolator::Tick(double InTime, TFunctionRef<void(const FName&, FLiveLinkAnimationFrameData&&)> InPushFrame)
+{
+	FOmniverseScopeLock ScopeLock(&Lock);
+	for (TPair<FName, FSubjectFrames>& Subject : Subjects)
+	{
+		FSubjectFrames& Frames = Subject.Value;
+		if (Frames.bHeld)
+		{
+			continue;
+		}
+
+		const double Period = Frames.NextTime - Frames.PreviousTime;
+		const bool bCanBlend = Frames.bHasPrevious
+			&& Period > 0.0 && Period <= MAX_INTERPOLATION_PERIOD_SECONDS
+			&& Frames.Previous.Transforms.Num() == Frames.Next.Transforms.Num()
+			&& Frames.Previous.PropertyValues.Num() == Frames.Next.PropertyValues.Num();
+
+		// Presented one period behind, the previous frame at the release of the next one
+		const float Alpha = bCanBlend ? (float)FMath::Clamp((InTime - Frames.NextTime) / Period, 0.0, 1.0) : 1.0f;
+		FLiveLinkAnimationFrameData Blended;
+		if (Alpha >= 1.0f)
+		{
+			Blended.Transforms = Frames.Next.Transforms;
+			Blended.PropertyValues = Frames.Next.PropertyValues;
+			Frames.bHeld = true;
+		}
+		else
+		{
+			Blended.Transforms.SetNumUninitialized(Frames.Next.Transforms.Num());
+			BlendTransforms(Frames.Previous.Transforms.GetData(), Frames.Next.Transforms.GetData(), Blended.Transforms.GetData(), Blended.Transforms.Num(), Alpha);
+			Blended.PropertyValues.SetNumUninitialized(Frames.Next.PropertyValues.Num());
+			BlendCurves(Frames.Previous.PropertyValues.GetData(), Frames.Next.PropertyValues.GetData(), Blended.PropertyValues.GetData(), Blended.PropertyValues.Num(), Alpha);
+		}
+
+		InPushFrame(Subject.Key, MoveTemp(Blended));
+	}
+}
+
+void FOmniverseFrameInterpolator::BlendCurves(const float* InFrom, const float* InTo, float* OutValues, int32 InNum, float InAlpha)
+{
+	const VectorRegister4Float Alpha = VectorSetFloat1(InAlpha);
+	int32 Index = 0;
+	for (; Index + 4 <= InNum; Index += 4)
+	{
+		const VectorRegister4Float From = VectorLoad(InFrom + Index);
+		const VectorRegister4Float To = VectorLoad(InTo + Index);
+		VectorStore(VectorMultiplyAdd(VectorSubtract(To, From), Alpha, From), OutValues + Index);
+	}
+
+	for (; Index < InNum; ++Index)
+	{
+		OutValues[Index] = FMath::Lerp(InFrom[Index], InTo[Index], InAlpha);
+	}
+}
+
+void FOmniverseFrameInterpolator::BlendTransforms(const FTransform* InFrom, const FTransform* InTo, FTransform* OutTransforms, int32 InNum, float InAlpha)
+{
+	// One transform at a time, FTransform::Blend works on its vector registers. The rotations of adjacent frames are close enough for its normalized lerp
+	for (int32 Index = 0; Index < InNum; ++Index)
+	{
+		OutTransforms[Index].Blend(InFrom[Index], InTo[Index], InAlpha);
+	}
+}
@@ -0,0 +1,48 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "Roles/LiveLinkAnimationTypes.h"
+
+// Upsampling of the animation frames to the engine rate.
+// The two last frames released for each subject are kept, and every engine tick pushes their blend, one frame period
+// behind the last release. So the face moves smoothly at any render rate while A2F keeps streaming at its own FPS
+class FOmniverseFrameInterpolator
+{
+public:
+	// Any thread: a decoded frame of a subject is released at InTime
+	void AddFrame(const FName& InSubjectName, FLiveLinkAnimationFrameData&& InFrame, double InTime);
+	// Subject is recreated or removed, its old frames aren't blended with the new ones
+	void ResetSubject(const FName& InSubjectName);
+	void ResetAll();
+
+	// Game thread: blend the frames of each subject at InTime, pushes only the subjects which changed since the last tick
+	void Tick(double InTime, TFunctionRef<void(const FName&, FLiveLinkAnimationFrameData&&)> InPushFrame);
+
+	// Lerp of the curve weights, 4 weights per instruction
+	static void BlendCurves(const float* InFrom, const float* InTo, float* OutValues, int32 InNum, float InAlpha);
+	// Lerp of the locations and the shortest path normalized lerp of the rotations
+	static void BlendTransforms(const FTransform* InFrom, const FTransform* InTo, FTransform* OutTransforms, int32 InNum, float InAlpha);
+
+private:
+	struct FSubjectFrames
+	{
+		FLiveLinkAnimationFrameData Previous;
+		FLiveLinkAnimationFrameData Next;
+		double PreviousTime = 0.0;
+		double NextTime = 0.0;
+		bool bHasPrevious = false;
+		// Next frame is pushed as it is, nothing to blend until a new frame
+		bool bHeld = false;
+	};
+
+	TMap<FName, FSubjectFrames> Subjects;
+	// Frames are added by the frame player thread and blended by the game thread
+	FCriticalSection Lock;
+};
@@ -0,0 +1,235 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "OmniverseFrameScheduler.h"
+#include "Async/Async.h"
+#include "HAL/Event.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/RunnableThread.h"
+#include "OmniverseRenderCheck.h"
+#include "OmniverseLiveLinkFramePlayer.h"
+#if PLATFORM_WINDOWS
+#include "Windows/AllowWindowsPlatformTypes.h"
+#include "Windows/WindowsHWrapper.h"
+#include "Windows/HideWindowsPlatformTypes.h"
+#endif
+
+static TAutoConsoleVariable<int32> CVarOmniversePacketPoolSize(
+	TEXT("omni.PacketPoolSize"),
+	256,
+	TEXT("Number of packet buffers preallocated for the frame players, more are added if it runs out.\n"),
+	ECVF_Default);
+
+// Wait time without any pending package, the enqueue wakes the thread
+#define IDLE_WAIT_TIME_MS 100
+
+#if PLATFORM_WINDOWS && !defined(CREATE_WAITABLE_TIMER_HIGH_RESOLUTION)
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+// Sleeps on a high resolution timer, so the release isn't rounded to the millisecond of an event wait
+class FOmniversePlatformSchedulerClock : public IOmniverseSchedulerClock
+{
+public:
+	FOmniversePlatformSchedulerClock()
+	{
+#if PLATFORM_WINDOWS
+		Timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		if (Timer == nullptr)
+		{
+			// Before Windows 10 1803, the timer has the resolution of the system timer
+			Timer = CreateWaitableTimerW(nullptr, false, nullptr);
+		}
+		WakeEvent = CreateEventW(nullptr, false, false, nullptr);
+#else
+		WakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+#endif
+	}
+
+	virtual ~FOmniversePlatformSchedulerClock()
+	{
+#if PLATFORM_WINDOWS
+		if (Timer)
+		{
+			CloseHandle(Timer);
+		}
+		CloseHandle(WakeEvent);
+#else
+		FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+#endif
+	}
+
+	virtual double Seconds() override
+	{
+		return FPlatformTime::Seconds();
+	}
+
+	virtual void WaitUntil(double InDeadline) override
+	{
+		const double WaitTime = InDeadline - FPlatformTime::Seconds();
+		if (WaitTime <= 0.0)
+		{
+			return;
+		}
+
+#if PLATFORM_WINDOWS
+		// Relative due time, in 100 ns units
+		LARGE_INTEGER DueTime;
+		DueTime.QuadPart = -FMath::Max((int64)(WaitTime * 1.0e7), (int64)1);
+		if (Timer && SetWaitableTimer(Timer, &DueTime, 0, nullptr, nullptr, false))
+		{
+			const HANDLE Handles[] = { WakeEvent, Timer };
+			if (WaitForMultipleObjects(UE_ARRAY_COUNT(Handles), Handles, false, INFINITE) == WAIT_OBJECT_0)
+			{
+				CancelWaitableTimer(Timer);
+			}
+			return;
+		}
+		WaitForSingleObject(WakeEvent, (DWORD)FMath::CeilToInt(WaitTime * 1000.0));
+#else
+		WakeEvent->Wait(FTimespan::FromSeconds(WaitTime));
+#endif
+	}
+
+	virtual void Wake() override
+	{
+#if PLATFORM_WINDOWS
+		SetEvent(WakeEvent);
+#else
+		WakeEvent->Trigger();
+#endif
+	}
+
+private:
+#if PLATFORM_WINDOWS
+	HANDLE Timer = nullptr;
+	HANDLE WakeEvent = nullptr;
+#else
+	FEvent* WakeEvent = nullptr;
+#endif
+};
+
+TUniquePtr<FOmniverseFrameScheduler> FOmniverseFrameScheduler::Instance;
+
+FOmniverseFrameScheduler::FOmniverseFrameScheduler(TSharedPtr<IOmniverseSchedulerClock> InClock)
+	: ThreadStopping(false)
+	, Clock(InClock.IsValid() ? InClock.ToSharedRef() : StaticCastSharedRef<IOmniverseSchedulerClock>(MakeShared<FOmniversePlatformSchedulerClock>()))
+	, PacketPool(CVarOmniversePacketPoolSize.GetValueOnAnyThread())
+{
+}
+
+FOmniverseFrameScheduler::~FOmniverseFrameScheduler()
+{
+	StopThread();
+
+	// Players may hold packets of the pool until they're destroyed
+	TickingPlayers.Empty();
+	Players.Empty();
+}
+
+void FOmniverseFrameScheduler::Start()
+{
+	ThreadStopping = false;
+	if (Thread == nullptr)
+	{
+		FString ThreadName = TEXT("Omniverse LiveLink Replayer ");
+		ThreadName.AppendInt(FAsyncThreadIndex::GetNext());
+		Thread = FRunnableThread::Create(this, *ThreadName, 128 * 1024, TPri_AboveNormal, FPlatformAffinity::GetPoolThreadMask());
+	}
+}
+
+void FOmniverseFrameScheduler::StopThread()
+{
+	Stop();
+
+	if (Thread)
+	{
+		Thread->WaitForCompletion();
+		delete Thread;
+		Thread = nullptr;
+	}
+}
+
+void FOmniverseFrameScheduler::Stop()
+{
+	ThreadStopping = true;
+	Wake();
+}
+
+void FOmniverseFrameScheduler::Wake()
+{
+	Clock->Wake();
+}
+
+void FOmniverseFrameScheduler::RegisterPlayer(TSharedPtr<FOmniverseLiveLinkFramePlayer, ESPMode::ThreadSafe> Player)
+{
+	FOmniverseScopeLock Lock(&PlayersLock);
+	Players.AddUnique(Player);
+}
+
+void FOmniverseFrameScheduler::UnregisterPlayer(TSharedPtr<FOmniverseLiveLinkFramePlayer, ESPMode::ThreadSafe> Player)
+{
+	FOmniverseScopeLock Lock(&PlayersLock);
+	Players.Remove(Player);
+}
+
+uint32 FOmniverseFrameScheduler::Run()
+{
+	while (!ThreadStopping)
+	{
+		Step();
+	}
+	return 0;
+}
+
+bool FOmniverseFrameScheduler::Step()
+{
+	{
+		FOmniverseScopeLock Lock(&PlayersLock);
+		TickingPlayers = Players;
+	}
+
+	bool bPlayed = false;
+	double Deadline = DBL_MAX;
+	for (auto& Player : TickingPlayers)
+	{
+		double PlayerDeadline = DBL_MAX;
+		bPlayed |= Player->Tick(Clock->Seconds(), PlayerDeadline);
+		Deadline = FMath::Min(Deadline, PlayerDeadline);
+	}
+
+	// Release the players unregistered meanwhile out of the lock
+	TickingPlayers.Reset();
+
+	// The next packages may be due already
+	if (bPlayed)
+	{
+		return true;
+	}
+
+	// Sleep until the next release, an enqueue, reset or stop wakes the thread earlier
+	Clock->WaitUntil(FMath::Min(Deadline, Clock->Seconds() + IDLE_WAIT_TIME_MS / 1000.0));
+	return Deadline != DBL_MAX;
+}
+
+FOmniverseFrameScheduler& FOmniverseFrameScheduler::Get()
+{
+	if (!Instance.IsValid())
+	{
+		Instance = MakeUnique<FOmniverseFrameScheduler>();
+	}
+	return *Instance;
+}
+
+void FOmniverseFrameScheduler::Shutdown()
+{
+	if (Instance.IsValid())
+	{
+		Instance->StopThread();
+	}
+}
@@ -0,0 +1,85 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeBool.h"
+#include "OmniversePacketPool.h"
+
+// Time source of the scheduler thread, simulated by the tests
+class IOmniverseSchedulerClock
+{
+public:
+	virtual ~IOmniverseSchedulerClock() {}
+
+	virtual double Seconds() = 0;
+	// Sleeps until the deadline, or until Wake() is called
+	virtual void WaitUntil(double InDeadline) = 0;
+	virtual void Wake() = 0;
+};
+
+// One thread releasing the packages of every frame player, each source has its own player and timeline.
+// It sleeps until the earliest release of all the players, or until a push or reset wakes it.
+class FOmniverseFrameScheduler : public FRunnable
+{
+public:
+	// The platform clock by default
+	explicit FOmniverseFrameScheduler(TSharedPtr<IOmniverseSchedulerClock> InClock = nullptr);
+	virtual ~FOmniverseFrameScheduler();
+
+	// Begin FRunnable Interface
+	virtual void Stop() override;
+	// End FRunnable Interface
+
+	void Start();
+	void Wake();
+	// Scheduler thread: ticks the players, then sleeps until the next release unless one was played.
+	// False if no package is waiting for its time
+	bool Step();
+
+	void RegisterPlayer(TSharedPtr<class FOmniverseLiveLinkFramePlayer, ESPMode::ThreadSafe> Player);
+	void UnregisterPlayer(TSharedPtr<class FOmniverseLiveLinkFramePlayer, ESPMode::ThreadSafe> Player);
+
+	// Shared by the players, so the packets are reused across the sources
+	FOmniversePacketPool& GetPacketPool() { return PacketPool; }
+
+	static FOmniverseFrameScheduler& Get();
+	// Module shutdown: stops and joins the thread, the players and the pool are kept for the sources not destroyed yet
+	static void Shutdown();
+
+protected:
+	// Begin FRunnable Interface
+	virtual bool Init() override { return true; }
+	virtual uint32 Run() override;
+	virtual void Exit() override {}
+	// End FRunnable Interface
+
+private:
+	void StopThread();
+
+	// Thread to run work operations on
+	class FRunnableThread* Thread = nullptr;
+
+	// Threadsafe Bool for terminating the main thread loop
+	FThreadSafeBool ThreadStopping;
+
+	// Sleeps until the next release, woken by the pushes
+	TSharedRef<IOmniverseSchedulerClock> Clock;
+
+	FOmniversePacketPool PacketPool;
+
+	// Guard Players between the scheduler thread and the sources
+	FCriticalSection PlayersLock;
+	TArray<TSharedPtr<class FOmniverseLiveLinkFramePlayer, ESPMode::ThreadSafe>> Players;
+	// Copy of Players ticked by the scheduler thread, keeps its capacity
+	TArray<TSharedPtr<class FOmniverseLiveLinkFramePlayer, ESPMode::ThreadSafe>> TickingPlayers;
+
+	static TUniquePtr<FOmniverseFrameScheduler> Instance;
+};
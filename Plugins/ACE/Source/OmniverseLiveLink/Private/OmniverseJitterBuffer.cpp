@@ -0,0 +1,109 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "OmniverseJitterBuffer.h"
+#include "OmniverseRenderCheck.h"
+
+// Gain of the jitter estimate, same as RFC 3550
+#define JITTER_GAIN (1.0 / 16.0)
+// Delay covering the jitter, in multiples of the estimate
+#define JITTER_DELAY_FACTOR 3.0
+// Released packages to compute the late rate
+#define LATE_RATE_WINDOW 300
+// Margin change after a window over the target, it shrinks at half the step
+#define MARGIN_STEP_SECONDS 0.01
+
+
+void FOmniverseJitterBuffer::SetBounds(double InMinDelay, double InMaxDelay, double InTargetLateRate)
+{
+	FOmniverseScopeLock ScopeLock(&Lock);
+	MinDelay = InMinDelay;
+	MaxDelay = FMath::Max(InMinDelay, InMaxDelay);
+	TargetLateRate = InTargetLateRate;
+}
+
+void FOmniverseJitterBuffer::OnArrival(double InArrivalTime, double InDeltaTime, bool bBegin)
+{
+	FOmniverseScopeLock ScopeLock(&Lock);
+	if (bBegin)
+	{
+		ScheduledTime.Reset();
+		LastTransit.Reset();
+		return;
+	}
+
+	// The first package after the header waits for the delay, the schedule starts from its arrival
+	if (!ScheduledTime.IsSet())
+	{
+		ScheduledTime = InArrivalTime;
+	}
+	else
+	{
+		ScheduledTime = ScheduledTime.GetValue() + InDeltaTime;
+	}
+
+	// A package ahead of its schedule waits in the queue, e.g. the frames of a burst sender, only the lateness is jitter
+	const double Transit = FMath::Max(InArrivalTime - ScheduledTime.GetValue(), 0.0);
+	if (LastTransit.IsSet())
+	{
+		Jitter += (FMath::Abs(Transit - LastTransit.GetValue()) - Jitter) * JITTER_GAIN;
+	}
+	LastTransit = Transit;
+}
+
+void FOmniverseJitterBuffer::OnRelease(bool bLate)
+{
+	FOmniverseScopeLock ScopeLock(&Lock);
+	++WindowFrames;
+	++TotalFrames;
+	if (bLate)
+	{
+		++WindowLateFrames;
+		++TotalLateFrames;
+	}
+
+	if (WindowFrames < LATE_RATE_WINDOW)
+	{
+		return;
+	}
+
+	const double LateRate = (double)WindowLateFrames / WindowFrames;
+	if (LateRate > TargetLateRate)
+	{
+		Margin = FMath::Min(Margin + MARGIN_STEP_SECONDS, MaxDelay);
+	}
+	else if (LateRate < TargetLateRate * 0.5)
+	{
+		Margin = FMath::Max(Margin - MARGIN_STEP_SECONDS * 0.5, 0.0);
+	}
+
+	WindowFrames = 0;
+	WindowLateFrames = 0;
+}
+
+double FOmniverseJitterBuffer::GetDelay() const
+{
+	FOmniverseScopeLock ScopeLock(&Lock);
+	return GetDelayLocked();
+}
+
+FOmniverseJitterBuffer::FStats FOmniverseJitterBuffer::GetStats() const
+{
+	FOmniverseScopeLock ScopeLock(&Lock);
+	FStats Stats;
+	Stats.Delay = GetDelayLocked();
+	Stats.Jitter = Jitter;
+	Stats.LateFrames = TotalLateFrames;
+	Stats.Frames = TotalFrames;
+	return Stats;
+}
+
+double FOmniverseJitterBuffer::GetDelayLocked() const
+{
+	return FMath::Clamp(Jitter * JITTER_DELAY_FACTOR + Margin, MinDelay, MaxDelay);
+}
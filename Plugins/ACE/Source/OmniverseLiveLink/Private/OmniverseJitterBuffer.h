@@ -0,0 +1,60 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+
+// Playout delay of a stream in the frame player, adapted to the network.
+// The arrival jitter is estimated from the variation of the late transit time (RFC 3550), packages arriving after their release
+// time are counted as late, and the delay grows when the late rate of a window is over the target, shrinks when it's well under.
+// The delay is applied at the start of the next stream.
+class FOmniverseJitterBuffer
+{
+public:
+	struct FStats
+	{
+		double Delay = 0.0;
+		double Jitter = 0.0;
+		int32 LateFrames = 0;
+		int32 Frames = 0;
+	};
+
+	// Delays in seconds, target rate in [0, 1]
+	void SetBounds(double InMinDelay, double InMaxDelay, double InTargetLateRate);
+
+	// Socket thread: a package arrived, it's released InDeltaTime after the previous one
+	void OnArrival(double InArrivalTime, double InDeltaTime, bool bBegin);
+	// Player thread: a package of a stream is released, late if it wasn't there in time
+	void OnRelease(bool bLate);
+
+	// Seconds to wait before the first package of a stream
+	double GetDelay() const;
+	FStats GetStats() const;
+
+private:
+	double GetDelayLocked() const;
+
+	mutable FCriticalSection Lock;
+
+	double MinDelay = 0.0;
+	double MaxDelay = 1.0;
+	double TargetLateRate = 0.01;
+
+	// Transit time of the last package relative to the stream schedule
+	TOptional<double> ScheduledTime;
+	TOptional<double> LastTransit;
+	double Jitter = 0.0;
+	// Added to the jitter based delay while the late rate is over the target
+	double Margin = 0.0;
+
+	int32 WindowFrames = 0;
+	int32 WindowLateFrames = 0;
+	int32 TotalFrames = 0;
+	int32 TotalLateFrames = 0;
+};
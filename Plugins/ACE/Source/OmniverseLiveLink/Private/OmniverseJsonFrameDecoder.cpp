@@ -0,0 +1,510 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "OmniverseJsonFrameDecoder.h"
+
+// Nesting of the values skipped by SkipValue
+#define MAX_SKIP_DEPTH 64
+
+
+static const double PowersOf10[] =
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+	1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static bool IsDigit(ANSICHAR Character)
+{
+	return Character >= '0' && Character <= '9';
+}
+
+static bool Equals(const FAnsiStringView& String, const ANSICHAR* Literal)
+{
+	return String.Equals(FAnsiStringView(Literal), ESearchCase::CaseSensitive);
+}
+
+bool FOmniverseJsonFrameDecoder::Decode(const uint8* InData, int32 InSize)
+{
+	Cursor = (const ANSICHAR*)InData;
+	End = Cursor + InSize;
+	NumSubjects = 0;
+
+	if (!Consume('{'))
+	{
+		return false;
+	}
+
+	if (Consume('}'))
+	{
+		return true;
+	}
+
+	do
+	{
+		FAnsiStringView SubjectName;
+		if (!ParseString(SubjectName) || !Consume(':'))
+		{
+			return false;
+		}
+
+		// Same as the DOM parsing, the subjects after it are ignored
+		if (Equals(SubjectName, "Disconnect"))
+		{
+			return true;
+		}
+
+		if (NumSubjects == Subjects.Num())
+		{
+			Subjects.AddDefaulted();
+		}
+
+		FSubject& Subject = Subjects[NumSubjects++];
+		Subject.Name = SubjectName;
+		if (!ParseSubject(Subject))
+		{
+			return false;
+		}
+	} while (Consume(','));
+
+	return Consume('}');
+}
+
+bool FOmniverseJsonFrameDecoder::ParseSubject(FSubject& OutSubject)
+{
+	OutSubject.bHasBody = false;
+	OutSubject.bHasFacial = false;
+	OutSubject.Bones.Reset();
+	OutSubject.CurveNames.Reset();
+	OutSubject.CurveWeights.Reset();
+
+	if (!Consume('{'))
+	{
+		return false;
+	}
+
+	if (Consume('}'))
+	{
+		return true;
+	}
+
+	do
+	{
+		FAnsiStringView Key;
+		if (!ParseString(Key) || !Consume(':'))
+		{
+			return false;
+		}
+
+		bool bParsed = false;
+		if (Equals(Key, "Body"))
+		{
+			bParsed = ParseBody(OutSubject);
+		}
+		else if (Equals(Key, "Facial"))
+		{
+			bParsed = ParseFacial(OutSubject);
+		}
+		else
+		{
+			bParsed = SkipValue();
+		}
+
+		if (!bParsed)
+		{
+			return false;
+		}
+	} while (Consume(','));
+
+	return Consume('}');
+}
+
+bool FOmniverseJsonFrameDecoder::ParseBody(FSubject& OutSubject)
+{
+	// No bones
+	if (Peek('{'))
+	{
+		return SkipValue();
+	}
+
+	if (!Consume('['))
+	{
+		return false;
+	}
+
+	OutSubject.bHasBody = true;
+	if (Consume(']'))
+	{
+		return true;
+	}
+
+	do
+	{
+		if (!ParseBone(OutSubject.Bones.AddDefaulted_GetRef()))
+		{
+			return false;
+		}
+	} while (Consume(','));
+
+	return Consume(']');
+}
+
+bool FOmniverseJsonFrameDecoder::ParseBone(FBone& OutBone)
+{
+	if (!Consume('{'))
+	{
+		return false;
+	}
+
+	bool bHasName = false;
+	bool bHasParentName = false;
+	bool bHasLocation = false;
+	bool bHasRotation = false;
+	if (!Consume('}'))
+	{
+		do
+		{
+			FAnsiStringView Key;
+			if (!ParseString(Key) || !Consume(':'))
+			{
+				return false;
+			}
+
+			bool bParsed = false;
+			if (Equals(Key, "Name"))
+			{
+				bParsed = bHasName = ParseString(OutBone.Name);
+			}
+			else if (Equals(Key, "ParentName"))
+			{
+				bParsed = bHasParentName = ParseString(OutBone.ParentName);
+			}
+			else if (Equals(Key, "Location"))
+			{
+				float Location[3];
+				bParsed = bHasLocation = ParseNumberArray(Location, 3);
+				OutBone.Location = FVector3f(Location[0], Location[1], Location[2]);
+			}
+			else if (Equals(Key, "Rotation"))
+			{
+				float Rotation[4];
+				bParsed = bHasRotation = ParseNumberArray(Rotation, 4);
+				OutBone.Rotation = FQuat4f(Rotation[0], Rotation[1], Rotation[2], Rotation[3]);
+			}
+			else
+			{
+				bParsed = SkipValue();
+			}
+
+			if (!bParsed)
+			{
+				return false;
+			}
+		} while (Consume(','));
+
+		if (!Consume('}'))
+		{
+			return false;
+		}
+	}
+
+	// Invalid format, let the DOM parsing decide
+	return bHasName && bHasParentName && bHasLocation && bHasRotation;
+}
+
+bool FOmniverseJsonFrameDecoder::ParseFacial(FSubject& OutSubject)
+{
+	if (!Consume('{'))
+	{
+		return false;
+	}
+
+	OutSubject.bHasFacial = true;
+	if (Consume('}'))
+	{
+		return true;
+	}
+
+	do
+	{
+		FAnsiStringView Key;
+		if (!ParseString(Key) || !Consume(':'))
+		{
+			return false;
+		}
+
+		if (Equals(Key, "Names") && Consume('['))
+		{
+			if (!Consume(']'))
+			{
+				do
+				{
+					if (!ParseString(OutSubject.CurveNames.AddDefaulted_GetRef()))
+					{
+						return false;
+					}
+				} while (Consume(','));
+
+				if (!Consume(']'))
+				{
+					return false;
+				}
+			}
+		}
+		else if (Equals(Key, "Weights") && Consume('['))
+		{
+			if (!Consume(']'))
+			{
+				do
+				{
+					if (!ParseNumber(OutSubject.CurveWeights.AddDefaulted_GetRef()))
+					{
+						return false;
+					}
+				} while (Consume(','));
+
+				if (!Consume(']'))
+				{
+					return false;
+				}
+			}
+		}
+		else if (!SkipValue())
+		{
+			return false;
+		}
+	} while (Consume(','));
+
+	return Consume('}');
+}
+
+bool FOmniverseJsonFrameDecoder::ParseNumberArray(float* OutValues, int32 NumValues)
+{
+	if (!Consume('['))
+	{
+		return false;
+	}
+
+	for (int32 Index = 0; Index < NumValues; ++Index)
+	{
+		if ((Index > 0 && !Consume(',')) || !ParseNumber(OutValues[Index]))
+		{
+			return false;
+		}
+	}
+
+	return Consume(']');
+}
+
+void FOmniverseJsonFrameDecoder::SkipWhitespace()
+{
+	while (Cursor < End && (*Cursor == ' ' || *Cursor == '\t' || *Cursor == '\n' || *Cursor == '\r'))
+	{
+		++Cursor;
+	}
+}
+
+bool FOmniverseJsonFrameDecoder::Peek(ANSICHAR Character)
+{
+	SkipWhitespace();
+	return Cursor < End && *Cursor == Character;
+}
+
+bool FOmniverseJsonFrameDecoder::Consume(ANSICHAR Character)
+{
+	if (Peek(Character))
+	{
+		++Cursor;
+		return true;
+	}
+	return false;
+}
+
+bool FOmniverseJsonFrameDecoder::ParseString(FAnsiStringView& OutString)
+{
+	if (!Consume('"'))
+	{
+		return false;
+	}
+
+	const ANSICHAR* Start = Cursor;
+	while (Cursor < End && *Cursor != '"')
+	{
+		// The names never need escaping, leave the rest to the DOM parsing
+		if (*Cursor == '\\')
+		{
+			return false;
+		}
+		++Cursor;
+	}
+
+	if (Cursor == End)
+	{
+		return false;
+	}
+
+	OutString = FAnsiStringView(Start, Cursor - Start);
+	++Cursor;
+	return true;
+}
+
+bool FOmniverseJsonFrameDecoder::ParseNumber(float& OutValue)
+{
+	SkipWhitespace();
+
+	bool bNegative = false;
+	if (Cursor < End && *Cursor == '-')
+	{
+		bNegative = true;
+		++Cursor;
+	}
+
+	if (Cursor == End || !IsDigit(*Cursor))
+	{
+		return false;
+	}
+
+	// Digits after the 19th don't fit, they only move the exponent
+	uint64 Mantissa = 0;
+	int32 NumDigits = 0;
+	int32 Exponent = 0;
+	for (; Cursor < End && IsDigit(*Cursor); ++Cursor)
+	{
+		if (NumDigits < 19)
+		{
+			Mantissa = Mantissa * 10 + (*Cursor - '0');
+			NumDigits += Mantissa > 0 ? 1 : 0;
+		}
+		else
+		{
+			++Exponent;
+		}
+	}
+
+	if (Cursor < End && *Cursor == '.')
+	{
+		++Cursor;
+		if (Cursor == End || !IsDigit(*Cursor))
+		{
+			return false;
+		}
+
+		for (; Cursor < End && IsDigit(*Cursor); ++Cursor)
+		{
+			if (NumDigits < 19)
+			{
+				Mantissa = Mantissa * 10 + (*Cursor - '0');
+				NumDigits += Mantissa > 0 ? 1 : 0;
+				--Exponent;
+			}
+		}
+	}
+
+	if (Cursor < End && (*Cursor == 'e' || *Cursor == 'E'))
+	{
+		++Cursor;
+		bool bNegativeExponent = false;
+		if (Cursor < End && (*Cursor == '+' || *Cursor == '-'))
+		{
+			bNegativeExponent = *Cursor == '-';
+			++Cursor;
+		}
+
+		if (Cursor == End || !IsDigit(*Cursor))
+		{
+			return false;
+		}
+
+		int32 ExponentValue = 0;
+		for (; Cursor < End && IsDigit(*Cursor); ++Cursor)
+		{
+			ExponentValue = FMath::Min(ExponentValue * 10 + (*Cursor - '0'), 1000);
+		}
+		Exponent += bNegativeExponent ? -ExponentValue : ExponentValue;
+	}
+
+	double Value = (double)Mantissa;
+	const int32 MaxTableExponent = UE_ARRAY_COUNT(PowersOf10) - 1;
+	if (Exponent < 0)
+	{
+		Value = -Exponent <= MaxTableExponent ? Value / PowersOf10[-Exponent] : Value / FMath::Pow(10.0, (double)-Exponent);
+	}
+	else if (Exponent > 0)
+	{
+		Value = Exponent <= MaxTableExponent ? Value * PowersOf10[Exponent] : Value * FMath::Pow(10.0, (double)Exponent);
+	}
+
+	OutValue = (float)(bNegative ? -Value : Value);
+	return true;
+}
+
+bool FOmniverseJsonFrameDecoder::SkipValue()
+{
+	SkipWhitespace();
+	if (Cursor == End)
+	{
+		return false;
+	}
+
+	if (*Cursor == '"')
+	{
+		// Skip the escaped string too, its content isn't needed
+		++Cursor;
+		while (Cursor < End && *Cursor != '"')
+		{
+			Cursor += *Cursor == '\\' ? 2 : 1;
+		}
+		if (Cursor >= End)
+		{
+			return false;
+		}
+		++Cursor;
+		return true;
+	}
+
+	if (*Cursor == '{' || *Cursor == '[')
+	{
+		int32 Depth = 0;
+		while (Cursor < End)
+		{
+			const ANSICHAR Character = *Cursor;
+			if (Character == '"')
+			{
+				if (!SkipValue())
+				{
+					return false;
+				}
+				continue;
+			}
+
+			++Cursor;
+			if (Character == '{' || Character == '[')
+			{
+				if (++Depth > MAX_SKIP_DEPTH)
+				{
+					return false;
+				}
+			}
+			else if (Character == '}' || Character == ']')
+			{
+				if (--Depth == 0)
+				{
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	// Number, true, false or null
+	const ANSICHAR* Start = Cursor;
+	while (Cursor < End && *Cursor != ',' && *Cursor != '}' && *Cursor != ']' && *Cursor != ' ' && *Cursor != '\t' && *Cursor != '\n' && *Cursor != '\r')
+	{
+		++Cursor;
+	}
+	return Cursor > Start;
+}
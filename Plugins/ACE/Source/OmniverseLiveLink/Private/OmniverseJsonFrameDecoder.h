@@ -0,0 +1,66 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "Containers/StringView.h"
+
+// Single pass decoder of the A2F frame JSON:
+// {"Subject":{"Body":[{"Name","ParentName","Location","Rotation"}],"Facial":{"Names":[...],"Weights":[...]}}}
+// It reads the UTF-8 bytes directly, names are the views of the input and numbers are read into the reused buffers,
+// so nothing is allocated once the buffers are warm. Unknown keys are skipped.
+// Input it can't handle (e.g. escaped strings) is rejected, the caller should fall back to FJsonSerializer.
+class FOmniverseJsonFrameDecoder
+{
+public:
+	struct FBone
+	{
+		FAnsiStringView Name;
+		FAnsiStringView ParentName;
+		FVector3f Location;
+		FQuat4f Rotation;
+	};
+
+	struct FSubject
+	{
+		FAnsiStringView Name;
+		// "Body" is an array, it's an empty object without bones
+		bool bHasBody = false;
+		bool bHasFacial = false;
+		TArray<FBone> Bones;
+		TArray<FAnsiStringView> CurveNames;
+		TArray<float> CurveWeights;
+	};
+
+	// The views of the subjects are valid as long as the input data
+	bool Decode(const uint8* InData, int32 InSize);
+
+	int32 GetNumSubjects() const { return NumSubjects; }
+	const FSubject& GetSubject(int32 Index) const { return Subjects[Index]; }
+
+private:
+	bool ParseSubject(FSubject& OutSubject);
+	bool ParseBody(FSubject& OutSubject);
+	bool ParseBone(FBone& OutBone);
+	bool ParseFacial(FSubject& OutSubject);
+	bool ParseNumberArray(float* OutValues, int32 NumValues);
+
+	void SkipWhitespace();
+	bool Consume(ANSICHAR Character);
+	bool Peek(ANSICHAR Character);
+	bool ParseString(FAnsiStringView& OutString);
+	bool ParseNumber(float& OutValue);
+	bool SkipValue();
+
+	const ANSICHAR* Cursor = nullptr;
+	const ANSICHAR* End = nullptr;
+
+	// Only grows, so the buffers of subjects are reused
+	TArray<FSubject> Subjects;
+	int32 NumSubjects = 0;
+};
@@ -10,6 +10,7 @@
 #include "ACEPrivate.h"
 #include "OmniverseLiveLinkCommands.h"
 #include "OmniverseLiveLinkStyle.h"
+#include "OmniverseFrameScheduler.h"
 
 #include "Interfaces/IPluginManager.h"
 
@@ -36,6 +37,7 @@ void FOmniverseLiveLinkModule::ShutdownModule()
     // we call this function before unloading the module.
 	FOmniverseLiveLinkStyle::Shutdown();
 	FOmniverseLiveLinkCommands::Unregister();
+	FOmniverseFrameScheduler::Shutdown();
 }
 
 
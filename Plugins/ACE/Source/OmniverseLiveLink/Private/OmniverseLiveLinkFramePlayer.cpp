@@ -7,61 +7,96 @@
 // license agreement from NVIDIA CORPORATION is strictly prohibited.
 
 #include "OmniverseLiveLinkFramePlayer.h"
-#include "Async/Async.h"
-#include "HAL/Event.h"
-#include "HAL/RunnableThread.h"
-#include "GenericPlatform/GenericPlatformProcess.h"
 #include "GenericPlatform/GenericPlatformTime.h"
 #include "OmniverseBaseListener.h"
+#include "OmniverseFrameScheduler.h"
+#include "ACEPrivate.h"
+#include "OmniverseRenderCheck.h"
 
+// Interval of the release jitter logging
+#define RELEASE_JITTER_LOG_INTERVAL_SECONDS 10.0
+// Schedule this far behind restarts from the current time, after a stall of the sender or an idle player
+#define TIMELINE_REBASE_SECONDS 0.25
+// Audio stream started this long before the animation header is still the audio of the animation
+#define AV_SYNC_WINDOW_SECONDS 1.0
 
-TUniquePtr< FOmniverseLiveLinkFramePlayer > FOmniverseLiveLinkFramePlayer::Instance;
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("A/V Offset (ms)"), STAT_OmniverseAVOffset, STATGROUP_ACE);
+// Packages each queue can hold, minutes of animation frames or audio chunks
+#define PEND_BUFFER_CAPACITY 8192
+// Interval of the warnings of a full queue, the packages dropped meanwhile are counted
+#define OVERFLOW_LOG_INTERVAL_SECONDS 5.0
 
 FOmniverseLiveLinkFramePlayer::FOmniverseLiveLinkFramePlayer()
-	: Thread(nullptr)
-	, ThreadStopping(false)
+	: PacketPool(FOmniverseFrameScheduler::Get().GetPacketPool())
+	, AudioPendBuffer(PEND_BUFFER_CAPACITY)
+	, AnimePendBuffer(PEND_BUFFER_CAPACITY)
 	, ThreadReset(false)
-	, AnimeListener(nullptr)
-	, AudioListener(nullptr)
 {
-	
 }
 
 FOmniverseLiveLinkFramePlayer::~FOmniverseLiveLinkFramePlayer()
 {
-	Stop();
+	Reset();
 
-	if (Thread)
+	if (CurrentAudio.IsSet())
 	{
-		Thread->WaitForCompletion();
-		delete Thread;
+		PacketPool.Release(CurrentAudio.GetValue().Packet);
 	}
-}
-
-void FOmniverseLiveLinkFramePlayer::Start()
-{
-	if (Thread == nullptr)
+	if (CurrentAnime.IsSet())
 	{
-		FString ThreadName = TEXT("Omniverse LiveLink Replayer ");
-		ThreadName.AppendInt(FAsyncThreadIndex::GetNext());
-		Thread = FRunnableThread::Create(this, *ThreadName, 128 * 1024, TPri_AboveNormal, FPlatformAffinity::GetPoolThreadMask());
+		PacketPool.Release(CurrentAnime.GetValue().Packet);
 	}
-	ThreadStopping = false;
 }
 
 void FOmniverseLiveLinkFramePlayer::Reset()
 {
-	AudioPendBuffer.Empty();
-	AnimePendBuffer.Empty();
+	{
+		FOmniverseScopeLock Lock(&DequeueLock);
+		FPendBuffer DequeueData;
+		while (AudioPendBuffer.Dequeue(DequeueData))
+		{
+			PacketPool.Release(DequeueData.Packet);
+		}
+		while (AnimePendBuffer.Dequeue(DequeueData))
+		{
+			PacketPool.Release(DequeueData.Packet);
+		}
+	}
 	ThreadReset = true;
-	// NOTE:
-	// Don't reset AnimeListener and AudioListener here, because they're still be used in thread.
-	// They'll be released when the new listeners come
+	FOmniverseFrameScheduler::Get().Wake();
 }
 
-void FOmniverseLiveLinkFramePlayer::Stop()
+void FOmniverseLiveLinkFramePlayer::Interrupt()
 {
-	ThreadStopping = true;
+	FOmniverseScopeLock Lock(&PlayLock);
+	Reset();
+
+	if (CurrentAudio.IsSet())
+	{
+		PacketPool.Release(CurrentAudio.GetValue().Packet);
+		CurrentAudio.Reset();
+	}
+	if (CurrentAnime.IsSet())
+	{
+		PacketPool.Release(CurrentAnime.GetValue().Packet);
+		CurrentAnime.Reset();
+	}
+	ThreadReset = false;
+
+	// No stream is open, the next headers start from scratch
+	Fence = UINT8_MAX;
+	bAudioStreaming = false;
+	bAnimeStreaming = false;
+	bAnimeMediaStarted = false;
+
+	if (TSharedPtr<FOmniverseBaseListener, ESPMode::ThreadSafe> Listener = AudioListener.Pin())
+	{
+		Listener->OnInterrupt();
+	}
+	if (TSharedPtr<FOmniverseBaseListener, ESPMode::ThreadSafe> Listener = AnimeListener.Pin())
+	{
+		Listener->OnInterrupt();
+	}
 }
 
 void FOmniverseLiveLinkFramePlayer::RegisterAnime(TSharedPtr<class FOmniverseBaseListener, ESPMode::ThreadSafe> Listener)
@@ -74,57 +109,261 @@ void FOmniverseLiveLinkFramePlayer::RegisterAudio(TSharedPtr<class FOmniverseBas
 	AudioListener = Listener;
 }
 
-void FOmniverseLiveLinkFramePlayer::PushAudioData_AnyThread(const uint8* InData, int32 InSize, double DeltaTime, bool bBegin, bool bEnd)
+void FOmniverseLiveLinkFramePlayer::PushAudioData_AnyThread(const uint8* InData, int32 InSize, uint32 InConnectionId, double DeltaTime, bool bBegin, bool bEnd)
 {
-	AudioPendBuffer.Enqueue({ std::string((char*)InData, InSize), DeltaTime, bBegin, bEnd });
+	const double ArrivalTime = FPlatformTime::Seconds();
+	if (!bEnd)
+	{
+		AudioJitterBuffer.OnArrival(ArrivalTime, DeltaTime, bBegin);
+	}
+
+	FOmniverseScopeLock Lock(&AudioPushLock);
+	FOmniversePacket* Packet = PacketPool.Acquire(InData, InSize);
+	if (!AudioPendBuffer.Enqueue({ Packet, InConnectionId, DeltaTime, bBegin, bEnd, false, ArrivalTime }))
+	{
+		PacketPool.Release(Packet);
+		++AudioOverflow.NumDropped;
+		if (ArrivalTime - AudioOverflow.LastLogTime > OVERFLOW_LOG_INTERVAL_SECONDS)
+		{
+			UE_LOG(LogACE, Warning, TEXT("Audio queue of the frame player is full, %d packages dropped"), AudioOverflow.NumDropped);
+			AudioOverflow.LastLogTime = ArrivalTime;
+			AudioOverflow.NumDropped = 0;
+		}
+	}
+	FOmniverseFrameScheduler::Get().Wake();
 }
 
-void FOmniverseLiveLinkFramePlayer::PushAnimeData_AnyThread(const uint8* InData, int32 InSize, double DeltaTime, bool bBegin, bool bEnd)
+void FOmniverseLiveLinkFramePlayer::PushAnimeData_AnyThread(const uint8* InData, int32 InSize, uint32 InConnectionId, double DeltaTime, bool bBegin, bool bEnd)
 {
-	AnimePendBuffer.Enqueue({ std::string((char*)InData, InSize), DeltaTime, bBegin, bEnd });
+	const double ArrivalTime = FPlatformTime::Seconds();
+	if (!bEnd)
+	{
+		AnimeJitterBuffer.OnArrival(ArrivalTime, DeltaTime, bBegin);
+	}
+
+	FOmniverseScopeLock Lock(&AnimePushLock);
+	FOmniversePacket* Packet = PacketPool.Acquire(InData, InSize);
+	if (!AnimePendBuffer.Enqueue({ Packet, InConnectionId, DeltaTime, bBegin, bEnd, false, ArrivalTime }))
+	{
+		PacketPool.Release(Packet);
+		++AnimeOverflow.NumDropped;
+		if (ArrivalTime - AnimeOverflow.LastLogTime > OVERFLOW_LOG_INTERVAL_SECONDS)
+		{
+			UE_LOG(LogACE, Warning, TEXT("Animation queue of the frame player is full, %d packages dropped"), AnimeOverflow.NumDropped);
+			AnimeOverflow.LastLogTime = ArrivalTime;
+			AnimeOverflow.NumDropped = 0;
+		}
+	}
+	FOmniverseFrameScheduler::Get().Wake();
 }
 
 void FOmniverseLiveLinkFramePlayer::PlayAudio(double CurrentTime)
 {
-	if (AudioListener)
+	if (TSharedPtr<FOmniverseBaseListener, ESPMode::ThreadSafe> Listener = AudioListener.Pin())
 	{
-		AudioListener->OnPackageDataReceived((uint8*)CurrentAudio.GetValue().Buffer.data(), CurrentAudio.GetValue().Buffer.size());
+		const TArray<uint8>& Data = CurrentAudio.GetValue().Packet->Data;
+		Listener->OnPackageDataReceived(Data.GetData(), Data.Num(), CurrentAudio.GetValue().ConnectionId);
 	}
+	AudioJitter.Record(CurrentAudio.GetValue(), LastAudioPlayTime, CurrentTime);
+	UpdateJitterBuffer(AudioJitterBuffer, bAudioStreaming, CurrentAudio.GetValue(), LastAudioPlayTime);
+	LastAudioPlayTime = AudioTimeline.Advance(CurrentAudio.GetValue(), LastAudioPlayTime, CurrentTime, TEXT("Audio"));
+	PacketPool.Release(CurrentAudio.GetValue().Packet);
 	CurrentAudio.Reset();
-	LastAudioPlayTime = CurrentTime;
 }
 
 void FOmniverseLiveLinkFramePlayer::PlayAnime(double CurrentTime)
 {
-	if (AnimeListener)
+	if (TSharedPtr<FOmniverseBaseListener, ESPMode::ThreadSafe> Listener = AnimeListener.Pin())
+	{
+		const TArray<uint8>& Data = CurrentAnime.GetValue().Packet->Data;
+		Listener->OnPackageDataReceived(Data.GetData(), Data.Num(), CurrentAnime.GetValue().ConnectionId);
+	}
+	AnimeJitter.Record(CurrentAnime.GetValue(), LastAnimePlayTime, CurrentTime);
+	UpdateJitterBuffer(AnimeJitterBuffer, bAnimeStreaming, CurrentAnime.GetValue(), LastAnimePlayTime);
+
+	if (CurrentAnime.GetValue().BeginFence)
 	{
-		AnimeListener->OnPackageDataReceived((uint8*)CurrentAnime.GetValue().Buffer.data(), CurrentAnime.GetValue().Buffer.size());
+		AnimeBeginTime = CurrentTime;
+		AnimeMediaTime = 0.0;
+		bAnimeMediaStarted = false;
 	}
+	else if (!CurrentAnime.GetValue().EndFence)
+	{
+		AnimeMediaTime = GetAnimeMediaTime();
+		bAnimeMediaStarted = true;
+	}
+
+	LastAnimePlayTime = AnimeTimeline.Advance(CurrentAnime.GetValue(), LastAnimePlayTime, CurrentTime, TEXT("Animation"));
+	PacketPool.Release(CurrentAnime.GetValue().Packet);
 	CurrentAnime.Reset();
-	LastAnimePlayTime = CurrentTime;
 }
 
-uint32 FOmniverseLiveLinkFramePlayer::Run()
+double FOmniverseLiveLinkFramePlayer::FStreamTimeline::Advance(const FPendBuffer& InBuffer, double InLastScheduledTime, double InCurrentTime, const TCHAR* InName)
 {
-	while (!ThreadStopping)
+	// Header starts the timeline of the stream
+	if (InBuffer.BeginFence)
 	{
-		if (ThreadStopping)
+		StartTime = InCurrentTime;
+		LastReleaseTime = InCurrentTime;
+		NumPackages = 0;
+		return InCurrentTime;
+	}
+
+	const double ScheduledTime = InLastScheduledTime + InBuffer.DeltaPendingTime;
+	if (InBuffer.EndFence)
+	{
+		if (NumPackages > 0)
 		{
-			break;
+			EndTimeError = LastReleaseTime - InLastScheduledTime;
+			UE_LOG(LogACE, Log, TEXT("%s stream of %d packages ended %.3f ms after its schedule, %.3f s long"), InName, NumPackages, EndTimeError * 1000.0, LastReleaseTime - StartTime);
 		}
+		NumPackages = 0;
+		return ScheduledTime;
+	}
+
+	++NumPackages;
+	LastReleaseTime = InCurrentTime;
+	if (InCurrentTime - ScheduledTime > TIMELINE_REBASE_SECONDS)
+	{
+		return InCurrentTime;
+	}
+	return ScheduledTime;
+}
+
+void FOmniverseLiveLinkFramePlayer::FReleaseJitter::Record(const FPendBuffer& InBuffer, double InLastPlayTime, double InCurrentTime)
+{
+	// Only the packages which waited for their release, not the ones behind schedule or held by the fence
+	if (InBuffer.bScheduled && !InBuffer.EndFence)
+	{
+		Add(InCurrentTime - (InLastPlayTime + InBuffer.DeltaPendingTime));
+	}
+}
 
-		if (ThreadReset)
+void FOmniverseLiveLinkFramePlayer::FReleaseJitter::Add(double InValue)
+{
+	SumValue += InValue;
+	MaxValue = FMath::Max(MaxValue, InValue);
+	++NumReleases;
+}
+
+void FOmniverseLiveLinkFramePlayer::FReleaseJitter::Log(const TCHAR* InName, double InCurrentTime)
+{
+	if (InCurrentTime - LastLogTime < RELEASE_JITTER_LOG_INTERVAL_SECONDS)
+	{
+		return;
+	}
+
+	if (NumReleases > 0)
+	{
+		UE_LOG(LogACE, Verbose, TEXT("%s: average %.3f ms, max %.3f ms over %d packages"), InName, SumValue / NumReleases * 1000.0, MaxValue * 1000.0, NumReleases);
+	}
+
+	SumValue = 0.0;
+	MaxValue = -DBL_MAX;
+	NumReleases = 0;
+	LastLogTime = InCurrentTime;
+}
+
+int32 FOmniverseLiveLinkFramePlayer::GetAnimeReleaseJitter(double& OutAverage, double& OutMax) const
+{
+	OutAverage = AnimeJitter.NumReleases > 0 ? AnimeJitter.SumValue / AnimeJitter.NumReleases : 0.0;
+	OutMax = AnimeJitter.NumReleases > 0 ? AnimeJitter.MaxValue : 0.0;
+	return AnimeJitter.NumReleases;
+}
+
+void FOmniverseLiveLinkFramePlayer::UpdateJitterBuffer(FOmniverseJitterBuffer& InJitterBuffer, bool& bInOutStreaming, const FPendBuffer& InBuffer, double InLastPlayTime)
+{
+	if (InBuffer.BeginFence)
+	{
+		bInOutStreaming = true;
+	}
+	else if (InBuffer.EndFence)
+	{
+		bInOutStreaming = false;
+	}
+	else if (bInOutStreaming)
+	{
+		InJitterBuffer.OnRelease(InBuffer.ArrivalTime > InLastPlayTime + InBuffer.DeltaPendingTime);
+	}
+}
+
+double FOmniverseLiveLinkFramePlayer::GetAnimeMediaTime() const
+{
+	// The first frame after the header is the stream time 0, its pending time is the delay
+	return bAnimeMediaStarted ? AnimeMediaTime + CurrentAnime.GetValue().DeltaPendingTime : 0.0;
+}
+
+bool FOmniverseLiveLinkFramePlayer::GetAudioClockWaitTime(double CurrentTime, double& OutWaitTime) const
+{
+	const FPendBuffer& Anime = CurrentAnime.GetValue();
+	if (!bAnimeStreaming || Anime.BeginFence || Anime.EndFence)
+	{
+		return false;
+	}
+
+	TSharedPtr<FOmniverseBaseListener, ESPMode::ThreadSafe> Listener = AudioListener.Pin();
+	double AudioPosition = 0.0;
+	double AudioStartTime = 0.0;
+	if (!Listener || !Listener->GetPlaybackPosition(AudioPosition, AudioStartTime))
+	{
+		return false;
+	}
+
+	// The audio playing is of the previous stream
+	if (AudioStartTime < AnimeBeginTime - AV_SYNC_WINDOW_SECONDS)
+	{
+		return false;
+	}
+
+	// The interpolator reaches a frame one period after its release, the first frame of the stream is shown as it is
+	const double InterpolationLag = bInterpolatedAnime && bAnimeMediaStarted ? Anime.DeltaPendingTime : 0.0;
+	OutWaitTime = GetAnimeMediaTime() - InterpolationLag - AudioPosition;
+	return true;
+}
+
+double FOmniverseLiveLinkFramePlayer::GetNextDeadline(double CurrentTime, double AnimeReleaseTime) const
+{
+	double Deadline = DBL_MAX;
+	// The package past its release is held by the fence, it's released by the other stream
+	if (CurrentAudio.IsSet() && LastAudioPlayTime + CurrentAudio.GetValue().DeltaPendingTime > CurrentTime)
+	{
+		Deadline = FMath::Min(Deadline, LastAudioPlayTime + CurrentAudio.GetValue().DeltaPendingTime);
+	}
+
+	if (CurrentAnime.IsSet() && AnimeReleaseTime > CurrentTime)
+	{
+		Deadline = FMath::Min(Deadline, AnimeReleaseTime);
+	}
+
+	return Deadline;
+}
+
+bool FOmniverseLiveLinkFramePlayer::Tick(double CurrentTime, double& OutDeadline)
+{
+	FOmniverseScopeLock PlayScope(&PlayLock);
+	if (ThreadReset)
+	{
+		if (CurrentAudio.IsSet())
 		{
+			PacketPool.Release(CurrentAudio.GetValue().Packet);
 			CurrentAudio.Reset();
+		}
+		if (CurrentAnime.IsSet())
+		{
+			PacketPool.Release(CurrentAnime.GetValue().Packet);
 			CurrentAnime.Reset();
-			ThreadReset = false;
 		}
+		ThreadReset = false;
+	}
 
+	{
+		FOmniverseScopeLock Lock(&DequeueLock);
 		if (!CurrentAudio.IsSet())
 		{
 			FPendBuffer DequeueData;
 			if (AudioPendBuffer.Dequeue(DequeueData))
 			{
+				DequeueData.bScheduled = LastAudioPlayTime + DequeueData.DeltaPendingTime > CurrentTime;
 				CurrentAudio = DequeueData;
 			}
 		}
@@ -134,73 +373,85 @@ uint32 FOmniverseLiveLinkFramePlayer::Run()
 			FPendBuffer DequeueData;
 			if (AnimePendBuffer.Dequeue(DequeueData))
 			{
+				DequeueData.bScheduled = LastAnimePlayTime + DequeueData.DeltaPendingTime > CurrentTime;
 				CurrentAnime = DequeueData;
 			}
 		}
+	}
 
-		double CurrentTime = FPlatformTime::Seconds();
-		if (CurrentAudio.IsSet() && CurrentTime - LastAudioPlayTime >= CurrentAudio.GetValue().DeltaPendingTime)
+	bool bPlayed = false;
+	if (CurrentAudio.IsSet() && CurrentTime - LastAudioPlayTime >= CurrentAudio.GetValue().DeltaPendingTime)
+	{
+		if (CurrentAudio.GetValue().BeginFence)
 		{
-			if (CurrentAudio.GetValue().BeginFence)
-			{
-				Fence &= 0xFE;
-			}
+			Fence &= 0xFE;
+		}
 
-			bool IsAvailable = false;
-			if (CurrentAudio.GetValue().EndFence)
-			{
-				Fence |= 0x1;
-				if (Fence == UINT8_MAX)
-				{
-					IsAvailable = true;
-				}
-			}
-			else
+		bool IsAvailable = false;
+		if (CurrentAudio.GetValue().EndFence)
+		{
+			Fence |= 0x1;
+			if (Fence == UINT8_MAX)
 			{
 				IsAvailable = true;
 			}
+		}
+		else
+		{
+			IsAvailable = true;
+		}
 
-			if (IsAvailable)
-			{
-				PlayAudio(CurrentTime);
-			}
+		if (IsAvailable)
+		{
+			PlayAudio(CurrentTime);
+			bPlayed = true;
 		}
+	}
 
-		if (CurrentAnime.IsSet() && CurrentTime - LastAnimePlayTime >= CurrentAnime.GetValue().DeltaPendingTime)
+	// Animation follows the audio clock while its audio is played, the platform clock otherwise
+	double AudioWaitTime = 0.0;
+	const bool bAudioClock = CurrentAnime.IsSet() && GetAudioClockWaitTime(CurrentTime, AudioWaitTime);
+	const double AnimeReleaseTime = !CurrentAnime.IsSet() ? DBL_MAX : (bAudioClock ? CurrentTime + AudioWaitTime : LastAnimePlayTime + CurrentAnime.GetValue().DeltaPendingTime);
+	if (CurrentAnime.IsSet() && CurrentTime >= AnimeReleaseTime)
+	{
+		if (CurrentAnime.GetValue().BeginFence)
 		{
-			if (CurrentAnime.GetValue().BeginFence)
-			{
-				Fence &= 0xFD;
-			}
+			Fence &= 0xFD;
+		}
 
-			bool IsAvailable = false;
-			if (CurrentAnime.GetValue().EndFence)
-			{
-				Fence |= 0x2;
-				if (Fence == UINT8_MAX)
-				{
-					IsAvailable = true;
-				}
-			}
-			else
+		bool IsAvailable = false;
+		if (CurrentAnime.GetValue().EndFence)
+		{
+			Fence |= 0x2;
+			if (Fence == UINT8_MAX)
 			{
 				IsAvailable = true;
 			}
+		}
+		else
+		{
+			IsAvailable = true;
+		}
 
-			if (IsAvailable)
+		if (IsAvailable)
+		{
+			if (bAudioClock)
 			{
-				PlayAnime(CurrentTime);
+				// Audio ahead of the animation shown is positive, the lag of the interpolator included
+				const double Offset = -AudioWaitTime;
+				AVOffset.Add(Offset);
+				SET_FLOAT_STAT(STAT_OmniverseAVOffset, Offset * 1000.0);
 			}
+
+			PlayAnime(CurrentTime);
+			bPlayed = true;
 		}
 	}
-	return 0;
-}
 
-FOmniverseLiveLinkFramePlayer& FOmniverseLiveLinkFramePlayer::Get()
-{
-	if (!Instance.IsValid())
-	{
-		Instance = MakeUnique<FOmniverseLiveLinkFramePlayer>();
-	}
-	return *Instance;
+	AudioJitter.Log(TEXT("Audio release jitter"), CurrentTime);
+	AnimeJitter.Log(TEXT("Animation release jitter"), CurrentTime);
+	AVOffset.Log(TEXT("A/V offset"), CurrentTime);
+
+	OutDeadline = bPlayed ? CurrentTime : GetNextDeadline(CurrentTime, AnimeReleaseTime);
+	return bPlayed;
 }
@@ -8,69 +8,142 @@
 
 #pragma once
 #include "CoreMinimal.h"
-#include "Containers/Queue.h"
-#include "HAL/Runnable.h"
+#include "Containers/CircularQueue.h"
 #include "HAL/ThreadSafeBool.h"
-#include <string>
+#include "OmniversePacketPool.h"
+#include "OmniverseJitterBuffer.h"
 
 struct FPendBuffer
 {
-	// use std::string to avoid TChar to uint8 conversion
-	std::string Buffer;
+	// Owned by the queue or the current package of the player, returned to the pool after it's played
+	FOmniversePacket* Packet = nullptr;
+	uint32 ConnectionId = 0;
 	double DeltaPendingTime = 0.0;
 	bool BeginFence = false;
 	bool EndFence = false;
+	// Dequeued before its release time, so its release lateness is the scheduling jitter
+	bool bScheduled = false;
+	// Time it was pushed, the package is late for the jitter buffer if it came after its release time
+	double ArrivalTime = 0.0;
 };
 
-class FOmniverseLiveLinkFramePlayer : public FRunnable
+// Timeline of a source, releases its audio and animation packages at their time.
+// Players of all the sources are ticked by the FOmniverseFrameScheduler thread
+class FOmniverseLiveLinkFramePlayer
 {
 public:
 	DECLARE_DELEGATE_TwoParams(FOnFramePlayed, const uint8*, int32);
 public:
-	FOmniverseLiveLinkFramePlayer();
-	virtual ~FOmniverseLiveLinkFramePlayer();
+	// Absolute schedule of a stream: each package is due at the schedule of the previous one plus its pending time,
+	// so the lateness of a release doesn't delay the following ones. The end time error is logged at the end of the stream
+	struct FStreamTimeline
+	{
+		// Scheduled time of the released package
+		double Advance(const FPendBuffer& InBuffer, double InLastScheduledTime, double InCurrentTime, const TCHAR* InName);
+
+		double StartTime = 0.0;
+		double LastReleaseTime = 0.0;
+		int32 NumPackages = 0;
+		// Release of the last package of the ended stream after its schedule
+		double EndTimeError = 0.0;
+	};
 
-	// Begin FRunnable Interface
-	virtual void Stop() override;
-	// End FRunnable Interface
+	FOmniverseLiveLinkFramePlayer();
+	~FOmniverseLiveLinkFramePlayer();
 
-	void Start();
 	void Reset();
+	// Any thread: barge-in, the queued and current packages are dropped and both listeners flush what they play.
+	// No package is released after it returns
+	void Interrupt();
+	// Scheduler thread: release the due packages, true if any was played.
+	// OutDeadline is the next release time, DBL_MAX if nothing is waiting for its time
+	bool Tick(double CurrentTime, double& OutDeadline);
 
-	void PushAnimeData_AnyThread(const uint8* InData, int32 InSize, double DeltaTime, bool bBegin, bool bEnd);
-	void PushAudioData_AnyThread(const uint8* InData, int32 InSize, double DeltaTime, bool bBegin, bool bEnd);
+	void PushAnimeData_AnyThread(const uint8* InData, int32 InSize, uint32 InConnectionId, double DeltaTime, bool bBegin, bool bEnd);
+	void PushAudioData_AnyThread(const uint8* InData, int32 InSize, uint32 InConnectionId, double DeltaTime, bool bBegin, bool bEnd);
 
 	void RegisterAnime(TSharedPtr<class FOmniverseBaseListener, ESPMode::ThreadSafe> Listener);
 	void RegisterAudio(TSharedPtr<class FOmniverseBaseListener, ESPMode::ThreadSafe> Listener);
 
+	// The frames are blended by the interpolator, which shows them one frame period after their release.
+	// The frames synced to the audio are released one period early instead, the A/V offset is the one shown
+	void SetInterpolatedAnime(bool bInInterpolated) { bInterpolatedAnime = bInInterpolated; }
 
-	static FOmniverseLiveLinkFramePlayer& Get();
-
-protected:
-	// Begin FRunnable Interface
-	virtual bool Init() override { return true; }
-	virtual uint32 Run() override;
-	virtual void Exit() override {}
-	// End FRunnable Interface
+	FOmniverseJitterBuffer& GetAnimeJitterBuffer() { return AnimeJitterBuffer; }
+	// Timeline of the animation stream. Read while no package is played
+	const FStreamTimeline& GetAnimeTimeline() const { return AnimeTimeline; }
+	// Lateness of the animation releases since the last log, the number of releases. Read while no package is played
+	int32 GetAnimeReleaseJitter(double& OutAverage, double& OutMax) const;
+	FOmniverseJitterBuffer& GetAudioJitterBuffer() { return AudioJitterBuffer; }
 
 private:
 	void PlayAudio(double CurrentTime);
 	void PlayAnime(double CurrentTime);
-
-	// Thread to run work operations on
-	class FRunnableThread* Thread;
-
-	// Threadsafe Bool for terminating the main thread loop
-	FThreadSafeBool ThreadStopping;
-
-	TQueue<FPendBuffer> AudioPendBuffer;
-	TQueue<FPendBuffer> AnimePendBuffer;
-
+	// Count the late packages of a stream, between its begin and end fences
+	static void UpdateJitterBuffer(FOmniverseJitterBuffer& InJitterBuffer, bool& bInOutStreaming, const FPendBuffer& InBuffer, double InLastPlayTime);
+	// Earliest release time of the current packages, DBL_MAX if nothing is waiting for its time
+	double GetNextDeadline(double CurrentTime, double AnimeReleaseTime) const;
+	// Stream time of the current animation frame, from the FPS of the stream
+	double GetAnimeMediaTime() const;
+	// The current animation frame is synced to the audio being played, OutWaitTime is the audio time until its release
+	bool GetAudioClockWaitTime(double CurrentTime, double& OutWaitTime) const;
+
+	// Lateness or offset of the releases, logged periodically
+	struct FReleaseJitter
+	{
+		void Record(const FPendBuffer& InBuffer, double InLastPlayTime, double InCurrentTime);
+		void Add(double InValue);
+		void Log(const TCHAR* InName, double InCurrentTime);
+
+		double SumValue = 0.0;
+		double MaxValue = -DBL_MAX;
+		int32 NumReleases = 0;
+		double LastLogTime = 0.0;
+	};
+
+	// Fixed capacity queues of packet handles, nothing is allocated per package
+	FOmniversePacketPool& PacketPool;
+	TCircularQueue<FPendBuffer> AudioPendBuffer;
+	TCircularQueue<FPendBuffer> AnimePendBuffer;
+	// Single producer queues: serializes the listener threads pushing to the same queue
+	FCriticalSection AudioPushLock;
+	FCriticalSection AnimePushLock;
+	// Packages dropped by a full queue since its last warning, in its push lock
+	struct FQueueOverflow
+	{
+		int32 NumDropped = 0;
+		double LastLogTime = 0.0;
+	};
+	FQueueOverflow AudioOverflow;
+	FQueueOverflow AnimeOverflow;
+	// Single consumer queues: the scheduler thread and Reset() both dequeue
+	FCriticalSection DequeueLock;
+	// Held by Tick() while it releases the packages, Interrupt() waits for the one being played
+	FCriticalSection PlayLock;
+
+	// Scheduled time of the last released packages
 	double LastAnimePlayTime = 0.0;
 	double LastAudioPlayTime = 0.0;
 
+	FStreamTimeline AudioTimeline;
+	FStreamTimeline AnimeTimeline;
+
+	FReleaseJitter AudioJitter;
+	FReleaseJitter AnimeJitter;
+	// Audio position minus the stream time of the animation frames shown
+	FReleaseJitter AVOffset;
+
+	// Animation stream, its frames are released by the audio position while the audio of the same stream is played
+	double AnimeBeginTime = 0.0;
+	double AnimeMediaTime = 0.0;
+	bool bAnimeMediaStarted = false;
+	FThreadSafeBool bInterpolatedAnime = false;
 
-	static TUniquePtr< class FOmniverseLiveLinkFramePlayer > Instance;
+	// Playout delay of the streams, measured on push and release
+	FOmniverseJitterBuffer AudioJitterBuffer;
+	FOmniverseJitterBuffer AnimeJitterBuffer;
+	bool bAudioStreaming = false;
+	bool bAnimeStreaming = false;
 
 	TOptional<FPendBuffer> CurrentAudio;
 	TOptional<FPendBuffer> CurrentAnime;
@@ -78,6 +151,7 @@ private:
 	uint8 Fence = UINT8_MAX;
 	FThreadSafeBool ThreadReset;
 
-	TSharedPtr<class FOmniverseBaseListener, ESPMode::ThreadSafe> AnimeListener;
-	TSharedPtr<class FOmniverseBaseListener, ESPMode::ThreadSafe> AudioListener;
+	// Listeners own the player, they're pinned while a package is played
+	TWeakPtr<class FOmniverseBaseListener, ESPMode::ThreadSafe> AnimeListener;
+	TWeakPtr<class FOmniverseBaseListener, ESPMode::ThreadSafe> AudioListener;
 };
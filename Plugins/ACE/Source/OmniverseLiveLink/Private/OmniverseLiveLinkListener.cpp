@@ -16,9 +16,103 @@
 
 #include "ACEPrivate.h"
 #include "OmniverseLiveLinkSourceSettings.h"
+#include "Misc/App.h"
+#include "OmniverseRenderCheck.h"
 
 #define LOCTEXT_NAMESPACE "OmniverseLiveLinkListener"
 
+// Owner of the subjects which connection is closed
+#define CLOSED_CONNECTION_ID 0
+// Magic word and frame index
+#define BINARY_FRAME_HEADER_SIZE 8
+// Location X, Y, Z and rotation X, Y, Z, W
+#define BINARY_FLOATS_PER_BONE 7
+
+static const uint8 BinaryFrameMagic[] = { 'B', 'F', 'R', 'M' };
+
+// The binary layout follows the text of the binary stream header, after a NUL
+static int32 GetHeaderTextSize(const uint8* InPackageData, int32 InPackageSize)
+{
+	for (int32 Index = 0; Index < InPackageSize; ++Index)
+	{
+		if (InPackageData[Index] == 0)
+		{
+			return Index;
+		}
+	}
+	return InPackageSize;
+}
+
+// Index of a binary frame in its stream, little-endian after the magic word
+static uint32 GetBinaryFrameIndex(const uint8* InPackageData)
+{
+	const uint8* IndexData = InPackageData + sizeof(BinaryFrameMagic);
+	return IndexData[0] | (IndexData[1] << 8) | (IndexData[2] << 16) | ((uint32)IndexData[3] << 24);
+}
+
+// Curve names are compared by the hash of their UTF-8 text, no FName lookup on every frame.
+// The length of each name goes first, so the same text split into other names has another hash
+static uint32 HashCurveName(const ANSICHAR* InName, int32 InLength, uint32 InHash)
+{
+	const uint32 LengthHash = FCrc::MemCrc32(&InLength, sizeof(InLength), InHash);
+	return FCrc::MemCrc32(InName, InLength, LengthHash);
+}
+
+namespace
+{
+	// Little-endian reader of the binary stream layout, fails instead of reading out of range
+	struct FBinaryReader
+	{
+		FBinaryReader(const uint8* InData, int32 InSize)
+			: Data(InData), Size(InSize)
+		{
+		}
+
+		bool ReadUInt16(uint16& OutValue)
+		{
+			if (Offset + (int32)sizeof(uint16) > Size)
+			{
+				return false;
+			}
+			OutValue = Data[Offset] | (Data[Offset + 1] << 8);
+			Offset += sizeof(uint16);
+			return true;
+		}
+
+		bool ReadInt16(int16& OutValue)
+		{
+			uint16 Value = 0;
+			if (!ReadUInt16(Value))
+			{
+				return false;
+			}
+			OutValue = (int16)Value;
+			return true;
+		}
+
+		bool ReadName(FName& OutName, bool bLowerCase = false, uint32* InOutHash = nullptr)
+		{
+			uint16 Length = 0;
+			if (!ReadUInt16(Length) || Offset + Length > Size)
+			{
+				return false;
+			}
+			FString Name(Length, (const ANSICHAR*)(Data + Offset));
+			OutName = FName(bLowerCase ? *Name.ToLower() : *Name);
+			if (InOutHash)
+			{
+				*InOutHash = HashCurveName((const ANSICHAR*)(Data + Offset), Length, *InOutHash);
+			}
+			Offset += Length;
+			return true;
+		}
+
+		const uint8* Data;
+		int32 Size;
+		int32 Offset = 0;
+	};
+}
+
 
 FOmniverseLiveLinkListener::FOmniverseLiveLinkListener(uint32 InPort)
 	: FOmniverseBaseListener(InPort)
@@ -29,14 +123,135 @@ FOmniverseLiveLinkListener::~FOmniverseLiveLinkListener()
 {
 }
 
-void FOmniverseLiveLinkListener::OnPackageDataReceived(const uint8* InPackageData, int32 InPackageSize)
+void FOmniverseLiveLinkListener::OnPackageDataReceived(const uint8* InPackageData, int32 InPackageSize, uint32 InConnectionId)
+{
+	FOmniverseScopeLock Lock(&SubjectsLock);
+	// Played by the frame player, or not in a stream
+	FramePresentationTime = FPlatformTime::Seconds();
+	ParsePackage(InPackageData, InPackageSize, InConnectionId);
+}
+
+void FOmniverseLiveLinkListener::OnPackageDataPushed(const uint8* InPackageData, int32 InPackageSize, uint32 InConnectionId, double DeltaTime, bool bBegin, bool bEnd)
+{
+	if (!bTimedEvaluation)
+	{
+		if (FramePlayer)
+		{
+			FramePlayer->PushAnimeData_AnyThread(InPackageData, InPackageSize, InConnectionId, DeltaTime, bBegin, bEnd);
+		}
+		return;
+	}
+
+	// Stamped with the time it would be played at, LiveLink buffers it and applies its own evaluation offset
+	FOmniverseScopeLock Lock(&SubjectsLock);
+	if (bEnd)
+	{
+		StreamTimelines.Remove(InConnectionId);
+		return;
+	}
+
+	FStreamTimeline* Timeline = StreamTimelines.Find(InConnectionId);
+	if (bBegin || Timeline == nullptr)
+	{
+		// A stream without its header starts at its first frame
+		Timeline = &StreamTimelines.Add(InConnectionId);
+		Timeline->StartTime = FPlatformTime::Seconds();
+		Timeline->PresentationTime = Timeline->StartTime;
+		if (bBegin && !GetFPSInHeader(InPackageData, InPackageSize, Timeline->FrameRate))
+		{
+			Timeline->FrameRate = 0.0;
+		}
+	}
+
+	if (!bBegin)
+	{
+		// The first frame is at the stream start, the delay is the evaluation offset of LiveLink
+		int64 FrameIndex = Timeline->NextFrameIndex++;
+		if (IsBinaryFrame(InPackageData, InPackageSize))
+		{
+			FrameIndex = GetBinaryFrameIndex(InPackageData);
+		}
+
+		if (Timeline->FrameRate > 0.0)
+		{
+			// No rounding error accumulates over a long stream
+			Timeline->PresentationTime = Timeline->StartTime + FrameIndex / Timeline->FrameRate;
+		}
+		else if (FrameIndex > 0)
+		{
+			Timeline->PresentationTime += DeltaTime;
+		}
+	}
+
+	FramePresentationTime = Timeline->PresentationTime;
+	ParsePackage(InPackageData, InPackageSize, InConnectionId);
+}
+
+void FOmniverseLiveLinkListener::ParsePackage(const uint8* InPackageData, int32 InPackageSize, uint32 InConnectionId)
+{
+	if (IsBinaryFrame(InPackageData, InPackageSize))
+	{
+		ParseBinaryFrame(InPackageData, InPackageSize, InConnectionId);
+	}
+	else
+	{
+		ParseJSON(InPackageData, InPackageSize, InConnectionId);
+	}
+}
+
+void FOmniverseLiveLinkListener::OnConnectionClosed(uint32 InConnectionId)
 {
-	ParseJSON(InPackageData, InPackageSize);
+	FOmniverseScopeLock Lock(&SubjectsLock);
+
+	BinaryLayouts.Remove(InConnectionId);
+
+	// Keep the last pose of the subjects, they can be taken by the other connections
+	TMap<FName, bool> Subjects;
+	if (ConnectionSubjects.RemoveAndCopyValue(InConnectionId, Subjects))
+	{
+		TMap<FName, bool>& ClosedSubjects = ConnectionSubjects.FindOrAdd(CLOSED_CONNECTION_ID);
+		for (auto& Subject : Subjects)
+		{
+			ClosedSubjects.Add(Subject.Key, true);
+		}
+	}
 }
 
-void FOmniverseLiveLinkListener::OnPackageDataPushed(const uint8* InPackageData, int32 InPackageSize, double DeltaTime, bool bBegin, bool bEnd)
+void FOmniverseLiveLinkListener::OnInterrupt()
 {
-	FOmniverseLiveLinkFramePlayer::Get().PushAnimeData_AnyThread(InPackageData, InPackageSize, DeltaTime, bBegin, bEnd);
+	FOmniverseBaseListener::OnInterrupt();
+
+	FOmniverseScopeLock Lock(&SubjectsLock);
+	StreamTimelines.Empty();
+	if (LiveLinkClient == nullptr)
+	{
+		return;
+	}
+
+	// Each subject returns to neutral: the curves at 0 and the bones where they are
+	FramePresentationTime = FPlatformTime::Seconds();
+	for (const TPair<FName, FStaticDataSignature>& Signature : StaticDataSignatures)
+	{
+		if (bTimedEvaluation)
+		{
+			// The frames LiveLink buffered for later are of the interrupted stream
+			LiveLinkClient->ClearSubjectsFrames_AnyThread(FLiveLinkSubjectKey(SourceGuid, Signature.Key));
+		}
+
+		FLiveLinkFrameDataStruct AnimationStruct(FLiveLinkAnimationFrameData::StaticStruct());
+		FLiveLinkAnimationFrameData& NeutralData = *AnimationStruct.Cast<FLiveLinkAnimationFrameData>();
+		const TArray<FTransform>* Transforms = LastTransforms.Find(Signature.Key);
+		if (Transforms && Transforms->Num() == Signature.Value.NumBones)
+		{
+			NeutralData.Transforms = *Transforms;
+		}
+		else
+		{
+			NeutralData.Transforms.SetNum(Signature.Value.NumBones);
+		}
+		NeutralData.PropertyValues.SetNumZeroed(Signature.Value.NumCurves);
+		PushFrameData(Signature.Key, MoveTemp(AnimationStruct));
+	}
 }
 
 uint32 FOmniverseLiveLinkListener::GetDelayTime() const
@@ -46,7 +261,14 @@ uint32 FOmniverseLiveLinkListener::GetDelayTime() const
 		UOmniverseLiveLinkSourceSettings* Settings = Cast<UOmniverseLiveLinkSourceSettings>(LiveLinkClient->GetSourceSettings(SourceGuid));
 		if (Settings)
 		{
-			return Settings->AnimationDelayTime;
+			if (!Settings->bAdaptiveDelay || !FramePlayer)
+			{
+				return Settings->AnimationDelayTime;
+			}
+
+			FOmniverseJitterBuffer& JitterBuffer = FramePlayer->GetAnimeJitterBuffer();
+			JitterBuffer.SetBounds(Settings->AnimationMinDelayTime / 1000.0, Settings->AnimationMaxDelayTime / 1000.0, Settings->TargetLatePercentage / 100.0);
+			return FMath::RoundToInt(JitterBuffer.GetDelay() * 1000.0);
 		}
 	}
 
@@ -77,11 +299,11 @@ bool FOmniverseLiveLinkListener::IsHeaderPackage(const uint8* InPackageData, int
 
 bool FOmniverseLiveLinkListener::GetFPSInHeader(const uint8* InPackageData, int32 InPackageSize, double& OutFPS) const
 {
-	FString HeaderString = FString(InPackageSize, (ANSICHAR*)InPackageData);
+	FString HeaderString = FString(GetHeaderTextSize(InPackageData, InPackageSize), (ANSICHAR*)InPackageData);
 	TArray<FString> A2FInfoStrings;
 	HeaderString.ParseIntoArray(A2FInfoStrings, *HeaderSeparator);
 
-	if (A2FInfoStrings.Num() == 2)
+	if (A2FInfoStrings.Num() >= 2)
 	{
 		OutFPS = FCString::Atoi(*A2FInfoStrings[1]);
 		return OutFPS > 0;
@@ -90,24 +312,46 @@ bool FOmniverseLiveLinkListener::GetFPSInHeader(const uint8* InPackageData, int3
 	return false;
 }
 
-void FOmniverseLiveLinkListener::ResetUsingSubjects()
+void FOmniverseLiveLinkListener::ResetUsingSubjects(uint32 InConnectionId)
 {
-	for (auto& Subject : UsingSubjects)
+	for (auto& Subject : ConnectionSubjects.FindOrAdd(InConnectionId))
 	{
 		Subject.Value = false;
 	}
 }
 
-void FOmniverseLiveLinkListener::RemoveUnusedSubjects()
+bool FOmniverseLiveLinkListener::IsSubjectUsed(const FName& InSubjectName, uint32 InExceptConnectionId) const
+{
+	for (auto& Connection : ConnectionSubjects)
+	{
+		if (Connection.Key != InExceptConnectionId && Connection.Value.Contains(InSubjectName))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void FOmniverseLiveLinkListener::RemoveUnusedSubjects(uint32 InConnectionId)
 {
+	TMap<FName, bool>* UsingSubjects = ConnectionSubjects.Find(InConnectionId);
+	if (UsingSubjects == nullptr)
+	{
+		return;
+	}
+
 	TSet<FName> UnusedSubjects;
-	for (auto& Subject : UsingSubjects)
+	for (auto& Subject : *UsingSubjects)
 	{
 		if (!Subject.Value)
 		{
-			if (LiveLinkClient)
+			// The subject with the same name from another connection is still alive
+			if (LiveLinkClient && !IsSubjectUsed(Subject.Key, InConnectionId))
 			{
 				LiveLinkClient->RemoveSubject_AnyThread(FLiveLinkSubjectKey(SourceGuid, Subject.Key));
+				StaticDataSignatures.Remove(Subject.Key);
+				LastTransforms.Remove(Subject.Key);
+				Interpolator.ResetSubject(Subject.Key);
 			}
 			UnusedSubjects.Add(Subject.Key);
 		}
@@ -115,20 +359,332 @@ void FOmniverseLiveLinkListener::RemoveUnusedSubjects()
 
 	for (auto& SubjectName : UnusedSubjects)
 	{
-		if (UsingSubjects.Contains(SubjectName))
+		UsingSubjects->Remove(SubjectName);
+	}
+}
+
+void FOmniverseLiveLinkListener::ClearAllSubjects()
+{
+	FOmniverseScopeLock Lock(&SubjectsLock);
+
+	if (LiveLinkClient)
+	{
+		for (auto& Connection : ConnectionSubjects)
 		{
-			UsingSubjects.Remove(SubjectName);
+			for (auto& Subject : Connection.Value)
+			{
+				LiveLinkClient->RemoveSubject_AnyThread(FLiveLinkSubjectKey(SourceGuid, Subject.Key));
+			}
 		}
 	}
+	ConnectionSubjects.Empty();
+	StaticDataSignatures.Empty();
+	LastTransforms.Empty();
+	Interpolator.ResetAll();
 }
 
-void FOmniverseLiveLinkListener::ClearAllSubjects()
+void FOmniverseLiveLinkListener::TickInterpolation()
 {
-	ResetUsingSubjects();
-	RemoveUnusedSubjects();
+	if (!bInterpolateFrames || LiveLinkClient == nullptr)
+	{
+		return;
+	}
+
+	const double CurrentTime = FPlatformTime::Seconds();
+	Interpolator.Tick(CurrentTime, [this, CurrentTime](const FName& InSubjectName, FLiveLinkAnimationFrameData&& InFrame)
+	{
+		FLiveLinkFrameDataStruct AnimationStruct(FLiveLinkAnimationFrameData::StaticStruct());
+		*AnimationStruct.Cast<FLiveLinkAnimationFrameData>() = MoveTemp(InFrame);
+		StampFrameTime(*AnimationStruct.Cast<FLiveLinkAnimationFrameData>(), CurrentTime);
+		LiveLinkClient->PushSubjectFrameData_AnyThread(FLiveLinkSubjectKey(SourceGuid, InSubjectName), MoveTemp(AnimationStruct));
+	});
+}
+
+void FOmniverseLiveLinkListener::PushFrameData(const FName& InSubjectName, FLiveLinkFrameDataStruct&& InFrameData)
+{
+	// Copied into the same allocation each frame
+	const TArray<FTransform>& Transforms = InFrameData.Cast<FLiveLinkAnimationFrameData>()->Transforms;
+	if (Transforms.Num() > 0)
+	{
+		LastTransforms.FindOrAdd(InSubjectName) = Transforms;
+	}
+
+	// LiveLink interpolates the timed frames itself
+	if (bInterpolateFrames && !bTimedEvaluation)
+	{
+		Interpolator.AddFrame(InSubjectName, MoveTemp(*InFrameData.Cast<FLiveLinkAnimationFrameData>()), FramePresentationTime);
+	}
+	else
+	{
+		StampFrameTime(*InFrameData.Cast<FLiveLinkAnimationFrameData>(), FramePresentationTime);
+		LiveLinkClient->PushSubjectFrameData_AnyThread(FLiveLinkSubjectKey(SourceGuid, InSubjectName), MoveTemp(InFrameData));
+	}
 }
 
-bool FOmniverseLiveLinkListener::ParseJSON(const uint8* InPackageData, int32 InPackageSize)
+void FOmniverseLiveLinkListener::StampFrameTime(FLiveLinkBaseFrameData& InOutFrame, double InPresentationTime)
+{
+	// No clock offset, the sender and the engine share the platform clock
+	InOutFrame.WorldTime = FLiveLinkWorldTime(InPresentationTime, 0.0);
+
+	// The engine timecode advanced by the time until the presentation
+	const TOptional<FQualifiedFrameTime> EngineFrameTime = FApp::GetCurrentFrameTime();
+	if (EngineFrameTime.IsSet())
+	{
+		const FFrameRate& Rate = EngineFrameTime.GetValue().Rate;
+		const FFrameTime FrameTime = EngineFrameTime.GetValue().Time + Rate.AsFrameTime(InPresentationTime - FApp::GetCurrentTime());
+		InOutFrame.MetaData.SceneTime = FQualifiedFrameTime(FrameTime, Rate);
+	}
+}
+
+void FOmniverseLiveLinkListener::ConvertBoneTransforms(TArray<FTransform>& InOutTransforms)
+{
+	// Right-handed to left-handed is the mirror of the Y axis:
+	// rotation (X, Y, Z, W) becomes (-X, Y, -Z, W) and location (X, Y, Z) becomes (X, -Y, Z)
+#if ENABLE_VECTORIZED_TRANSFORM
+	const VectorRegister4Double RotationMirror = MakeVectorRegisterDouble(-1.0, 1.0, -1.0, 1.0);
+	const VectorRegister4Double LocationMirror = MakeVectorRegisterDouble(1.0, -1.0, 1.0, 0.0);
+	for (FTransform& Transform : InOutTransforms)
+	{
+		Transform.SetRotationRegister(VectorMultiply(Transform.GetRotationRegister(), RotationMirror));
+		Transform.SetTranslationRegister(VectorMultiply(Transform.GetTranslationRegister(), LocationMirror));
+	}
+#else
+	for (FTransform& Transform : InOutTransforms)
+	{
+		const FQuat Rotation = Transform.GetRotation();
+		const FVector Location = Transform.GetTranslation();
+		Transform.SetRotation(FQuat(-Rotation.X, Rotation.Y, -Rotation.Z, Rotation.W));
+		Transform.SetTranslation(FVector(Location.X, -Location.Y, Location.Z));
+	}
+#endif
+}
+
+void FOmniverseLiveLinkListener::PushStaticData(const FName& InSubjectName, const TArray<FName>& InBoneNames, const TArray<int32>& InBoneParents, const TArray<FName>& InCurveNames, uint32 InCurveNamesHash)
+{
+	UE_LOG(LogACE, Log, TEXT("Creating subject '%s'"), *InSubjectName.ToString());
+
+	FLiveLinkStaticDataStruct StaticData(FLiveLinkSkeletonStaticData::StaticStruct());
+	FLiveLinkSkeletonStaticData* NewSkeletonData = StaticData.Cast<FLiveLinkSkeletonStaticData>();
+	NewSkeletonData->SetBoneNames(InBoneNames);
+	NewSkeletonData->SetBoneParents(InBoneParents);
+	// Facial need the static curve name
+	NewSkeletonData->PropertyNames = InCurveNames;
+
+	FLiveLinkSubjectKey Key = FLiveLinkSubjectKey(SourceGuid, InSubjectName);
+	LiveLinkClient->RemoveSubject_AnyThread(Key);
+	Interpolator.ResetSubject(InSubjectName);
+	LiveLinkClient->PushSubjectStaticData_AnyThread(Key, ULiveLinkAnimationRole::StaticClass(), MoveTemp(StaticData));
+
+	FStaticDataSignature& Signature = StaticDataSignatures.FindOrAdd(InSubjectName);
+	Signature.NumBones = InBoneNames.Num();
+	Signature.NumCurves = InCurveNames.Num();
+	Signature.CurveNamesHash = InCurveNamesHash;
+}
+
+void FOmniverseLiveLinkListener::MarkSubjectUsed(const FName& InSubjectName, uint32 InConnectionId)
+{
+	ConnectionSubjects.FindOrAdd(InConnectionId).Add(InSubjectName, true);
+	if (TMap<FName, bool>* ClosedSubjects = ConnectionSubjects.Find(CLOSED_CONNECTION_ID))
+	{
+		ClosedSubjects->Remove(InSubjectName);
+	}
+}
+
+bool FOmniverseLiveLinkListener::NeedsNewStaticData(const FName& InSubjectName, int32 InNumBones, int32 InNumCurves, uint32 InCurveNamesHash) const
+{
+	if (!IsSubjectUsed(InSubjectName))
+	{
+		return true;
+	}
+
+	// check if static data (bones and curve names) is changed, if it was changed, recreate the subject
+	const FStaticDataSignature* Signature = StaticDataSignatures.Find(InSubjectName);
+	if (Signature == nullptr)
+	{
+		return true;
+	}
+
+	// bone is changed, need to be recreated
+	if (InNumBones != INDEX_NONE && Signature->NumBones != InNumBones)
+	{
+		return true;
+	}
+
+	// different curves
+	if (InNumCurves != INDEX_NONE && (Signature->NumCurves != InNumCurves || Signature->CurveNamesHash != InCurveNamesHash))
+	{
+		return true;
+	}
+
+	return false;
+}
+
+void FOmniverseLiveLinkListener::ProcessDecodedSubject(const FOmniverseJsonFrameDecoder::FSubject& InSubject, uint32 InConnectionId)
+{
+	const FName SubjectName(InSubject.Name.Len(), InSubject.Name.GetData());
+	const int32 NumBones = InSubject.bHasBody ? InSubject.Bones.Num() : INDEX_NONE;
+	const int32 NumCurves = InSubject.bHasFacial ? InSubject.CurveNames.Num() : INDEX_NONE;
+
+	uint32 CurveNamesHash = 0;
+	for (const FAnsiStringView& CurveName : InSubject.CurveNames)
+	{
+		CurveNamesHash = HashCurveName(CurveName.GetData(), CurveName.Len(), CurveNamesHash);
+	}
+
+	// Names are only converted when the subject is created
+	if (NeedsNewStaticData(SubjectName, NumBones, NumCurves, CurveNamesHash))
+	{
+		TArray<FName> BoneNames;
+		TArray<int32> BoneParents;
+		BoneNames.SetNum(InSubject.Bones.Num());
+		BoneParents.SetNum(InSubject.Bones.Num());
+		for (int32 BoneIndex = 0; BoneIndex < InSubject.Bones.Num(); ++BoneIndex)
+		{
+			BoneNames[BoneIndex] = FName(*FString(InSubject.Bones[BoneIndex].Name).ToLower());
+			BoneParents[BoneIndex] = BoneIndex;
+		}
+
+		TArray<FName> CurveNames;
+		CurveNames.SetNum(InSubject.CurveNames.Num());
+		for (int32 CurveIndex = 0; CurveIndex < InSubject.CurveNames.Num(); ++CurveIndex)
+		{
+			CurveNames[CurveIndex] = FName(InSubject.CurveNames[CurveIndex].Len(), InSubject.CurveNames[CurveIndex].GetData());
+		}
+
+		PushStaticData(SubjectName, BoneNames, BoneParents, CurveNames, CurveNamesHash);
+	}
+	MarkSubjectUsed(SubjectName, InConnectionId);
+
+	FLiveLinkFrameDataStruct AnimationStruct(FLiveLinkAnimationFrameData::StaticStruct());
+	FLiveLinkAnimationFrameData& NewData = *AnimationStruct.Cast<FLiveLinkAnimationFrameData>();
+
+	NewData.Transforms.SetNumUninitialized(InSubject.Bones.Num());
+	for (int32 BoneIndex = 0; BoneIndex < InSubject.Bones.Num(); ++BoneIndex)
+	{
+		const FOmniverseJsonFrameDecoder::FBone& Bone = InSubject.Bones[BoneIndex];
+		NewData.Transforms[BoneIndex] = FTransform(FQuat(Bone.Rotation), FVector(Bone.Location));
+	}
+	ConvertBoneTransforms(NewData.Transforms);
+
+	if (InSubject.CurveNames.Num() > 0)
+	{
+		NewData.PropertyValues.SetNumZeroed(InSubject.CurveNames.Num());
+		const int32 NumWeights = FMath::Min(InSubject.CurveNames.Num(), InSubject.CurveWeights.Num());
+		FMemory::Memcpy(NewData.PropertyValues.GetData(), InSubject.CurveWeights.GetData(), NumWeights * sizeof(float));
+	}
+
+	PushFrameData(SubjectName, MoveTemp(AnimationStruct));
+}
+
+bool FOmniverseLiveLinkListener::IsBinaryFrame(const uint8* InPackageData, int32 InPackageSize) const
+{
+	return InPackageSize >= BINARY_FRAME_HEADER_SIZE && FMemory::Memcmp(InPackageData, BinaryFrameMagic, sizeof(BinaryFrameMagic)) == 0;
+}
+
+bool FOmniverseLiveLinkListener::ParseBinaryHeader(const uint8* InPackageData, int32 InPackageSize, uint32 InConnectionId)
+{
+	// Text stream
+	const int32 TextSize = GetHeaderTextSize(InPackageData, InPackageSize);
+	if (TextSize == InPackageSize)
+	{
+		BinaryLayouts.Remove(InConnectionId);
+		return true;
+	}
+
+	FBinaryReader Reader(InPackageData + TextSize + 1, InPackageSize - TextSize - 1);
+	FBinaryStreamLayout Layout;
+	uint16 NumBones = 0;
+	if (!Reader.ReadName(Layout.SubjectName) || !Reader.ReadUInt16(NumBones))
+	{
+		return false;
+	}
+
+	TArray<FName> BoneNames;
+	TArray<int32> BoneParents;
+	BoneNames.SetNum(NumBones);
+	BoneParents.SetNum(NumBones);
+	for (int32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
+	{
+		int16 ParentIndex = INDEX_NONE;
+		if (!Reader.ReadName(BoneNames[BoneIndex], true) || !Reader.ReadInt16(ParentIndex))
+		{
+			return false;
+		}
+		BoneParents[BoneIndex] = ParentIndex;
+	}
+
+	uint16 NumCurves = 0;
+	if (!Reader.ReadUInt16(NumCurves))
+	{
+		return false;
+	}
+
+	TArray<FName> CurveNames;
+	uint32 CurveNamesHash = 0;
+	CurveNames.SetNum(NumCurves);
+	for (int32 CurveIndex = 0; CurveIndex < NumCurves; ++CurveIndex)
+	{
+		if (!Reader.ReadName(CurveNames[CurveIndex], false, &CurveNamesHash))
+		{
+			return false;
+		}
+	}
+
+	Layout.NumBones = NumBones;
+	Layout.NumCurves = NumCurves;
+	BinaryLayouts.Add(InConnectionId, Layout);
+
+	if (LiveLinkClient)
+	{
+		ResetUsingSubjects(InConnectionId);
+		PushStaticData(Layout.SubjectName, BoneNames, BoneParents, CurveNames, CurveNamesHash);
+		MarkSubjectUsed(Layout.SubjectName, InConnectionId);
+		RemoveUnusedSubjects(InConnectionId);
+	}
+
+	return true;
+}
+
+bool FOmniverseLiveLinkListener::ParseBinaryFrame(const uint8* InPackageData, int32 InPackageSize, uint32 InConnectionId)
+{
+	const FBinaryStreamLayout* Layout = BinaryLayouts.Find(InConnectionId);
+	if (Layout == nullptr || LiveLinkClient == nullptr)
+	{
+		return false;
+	}
+
+	const int32 NumFloats = Layout->NumBones * BINARY_FLOATS_PER_BONE + Layout->NumCurves;
+	if (InPackageSize != BINARY_FRAME_HEADER_SIZE + NumFloats * sizeof(float))
+	{
+		UE_LOG(LogACE, Warning, TEXT("Binary frame size %d doesn't match the layout of subject '%s'"), InPackageSize, *Layout->SubjectName.ToString());
+		return false;
+	}
+
+	FLiveLinkFrameDataStruct AnimationStruct(FLiveLinkAnimationFrameData::StaticStruct());
+	FLiveLinkAnimationFrameData& NewData = *AnimationStruct.Cast<FLiveLinkAnimationFrameData>();
+
+	// Packed floats follow the magic and the frame index, they may not be aligned
+	const uint8* FloatData = InPackageData + BINARY_FRAME_HEADER_SIZE;
+
+	NewData.Transforms.SetNumUninitialized(Layout->NumBones);
+	for (int32 BoneIndex = 0; BoneIndex < Layout->NumBones; ++BoneIndex)
+	{
+		float Bone[BINARY_FLOATS_PER_BONE];
+		FMemory::Memcpy(Bone, FloatData, sizeof(Bone));
+		FloatData += sizeof(Bone);
+		NewData.Transforms[BoneIndex] = FTransform(FQuat(Bone[3], Bone[4], Bone[5], Bone[6]), FVector(Bone[0], Bone[1], Bone[2]));
+	}
+	ConvertBoneTransforms(NewData.Transforms);
+
+	NewData.PropertyValues.SetNumUninitialized(Layout->NumCurves);
+	FMemory::Memcpy(NewData.PropertyValues.GetData(), FloatData, Layout->NumCurves * sizeof(float));
+
+	MarkSubjectUsed(Layout->SubjectName, InConnectionId);
+	PushFrameData(Layout->SubjectName, MoveTemp(AnimationStruct));
+	return true;
+}
+
+bool FOmniverseLiveLinkListener::ParseJSON(const uint8* InPackageData, int32 InPackageSize, uint32 InConnectionId)
 {
 	if (IsEOSPackage(InPackageData, InPackageSize))
 	{
@@ -137,19 +693,31 @@ bool FOmniverseLiveLinkListener::ParseJSON(const uint8* InPackageData, int32 InP
 
 	if (IsHeaderPackage(InPackageData, InPackageSize))
 	{
-		//
-		// Nothing to do for blendshape header right now
-		// 
+		return ParseBinaryHeader(InPackageData, InPackageSize, InConnectionId);
+	}
+	else if (JsonDecoder.Decode(InPackageData, InPackageSize))
+	{
+		if (LiveLinkClient)
+		{
+			ResetUsingSubjects(InConnectionId);
+			for (int32 SubjectIndex = 0; SubjectIndex < JsonDecoder.GetNumSubjects(); ++SubjectIndex)
+			{
+				ProcessDecodedSubject(JsonDecoder.GetSubject(SubjectIndex), InConnectionId);
+			}
+			RemoveUnusedSubjects(InConnectionId);
+		}
+
 		return true;
 	}
 	else
 	{
+		// Fallback of the decoder, e.g. the escaped strings
 		FString JsonString = FString(InPackageSize, (ANSICHAR*)InPackageData);
 		TSharedPtr<FJsonObject> JsonObject;
 		TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(JsonString);
 		if (FJsonSerializer::Deserialize(Reader, JsonObject))
 		{
-			ResetUsingSubjects();
+			ResetUsingSubjects(InConnectionId);
 			for (TPair<FString, TSharedPtr<FJsonValue>>& JsonField : JsonObject->Values)
 			{
 				FName SubjectName(*JsonField.Key);
@@ -159,9 +727,9 @@ bool FOmniverseLiveLinkListener::ParseJSON(const uint8* InPackageData, int32 InP
 				}
 
 				const TSharedPtr<FJsonObject> DataObject = JsonField.Value->AsObject();
-				ProcessAnimationData(DataObject, SubjectName);
+				ProcessAnimationData(DataObject, SubjectName, InConnectionId);
 			}
-			RemoveUnusedSubjects();
+			RemoveUnusedSubjects(InConnectionId);
 
 			return true;
 		}
@@ -170,7 +738,7 @@ bool FOmniverseLiveLinkListener::ParseJSON(const uint8* InPackageData, int32 InP
 	return false;
 }
 
-void FOmniverseLiveLinkListener::ProcessAnimationData(const TSharedPtr<FJsonObject>& DataObject, const FName& InSubjectName)
+void FOmniverseLiveLinkListener::ProcessAnimationData(const TSharedPtr<FJsonObject>& DataObject, const FName& InSubjectName, uint32 InConnectionId)
 {
 	if (LiveLinkClient == nullptr)
 	{
@@ -182,40 +750,8 @@ void FOmniverseLiveLinkListener::ProcessAnimationData(const TSharedPtr<FJsonObje
 
 	const TSharedPtr<FJsonValue> Facial = DataObject->TryGetField(TEXT("Facial"));
 
-	bool bCreateSubject = !UsingSubjects.Contains(InSubjectName);
-
-	// NOTE: SkeletonData pointer to FrameData, so they must have the same scope
-	FLiveLinkSkeletonStaticData* SkeletonData = nullptr;
-	FLiveLinkSubjectFrameData FrameData;
-	if (!bCreateSubject)
-	{
-		// check if static data (bones and curve names) is changed, if it was changed, recreate the subject
-		auto AllSubjects = LiveLinkClient->GetSubjects(true, false);
-		for (auto Subject : AllSubjects)
-		{
-			if (Subject.SubjectName == InSubjectName)
-			{
-				auto SubjectRole = LiveLinkClient->GetSubjectRole_AnyThread(Subject);				
-				if (LiveLinkClient->EvaluateFrame_AnyThread(InSubjectName, SubjectRole, FrameData))
-				{
-					SkeletonData = FrameData.StaticData.Cast<FLiveLinkSkeletonStaticData>();
-				}
-				break;
-			}
-		}
-	}
-
-	// valid skeleton
-	if (SkeletonData && BoneArray)
-	{
-		// bone is changed, need to be recreated
-		if (SkeletonData->BoneNames.Num() != BoneArray->Num())
-		{
-			bCreateSubject = true;
-		}
-	}
-
 	TArray< FName > ExpNames;
+	uint32 CurveNamesHash = 0;
 	if (Facial) // only facial need to check curve for now
 	{
 		auto ExpWeightObject = Facial->AsObject();
@@ -228,32 +764,24 @@ void FOmniverseLiveLinkListener::ProcessAnimationData(const TSharedPtr<FJsonObje
 				{
 					FString Name = (*ExpData)[Index]->AsString();
 					ExpNames.Add(FName(*Name));
-				}
-			}
-		}
 
-		if (SkeletonData)
-		{
-			// different number of curves
-			if (SkeletonData->PropertyNames.Num() != ExpNames.Num())
-			{
-				bCreateSubject = true;
+					FTCHARToUTF8 Utf8Name(*Name);
+					CurveNamesHash = HashCurveName(Utf8Name.Get(), Utf8Name.Length(), CurveNamesHash);
+				}
 			}
 		}
 	}
 
+	bool bCreateSubject = NeedsNewStaticData(InSubjectName, BoneArray ? BoneArray->Num() : INDEX_NONE, Facial ? ExpNames.Num() : INDEX_NONE, CurveNamesHash);
+
 	// Create static data : skeleton and curves
 	if (bCreateSubject)
 	{
-		UE_LOG(LogACE, Log, TEXT("Creating subject '%s'"), *InSubjectName.ToString());
-
-		FLiveLinkStaticDataStruct StaticData(FLiveLinkSkeletonStaticData::StaticStruct());
-		FLiveLinkSkeletonStaticData* NewSkeletonData = StaticData.Cast<FLiveLinkSkeletonStaticData>();
 		TArray<FName> BoneNames;
+		TArray<int32> BoneParents;
 		if (BoneArray)
 		{
 			BoneNames.SetNumUninitialized(BoneArray->Num());
-			TArray<int32> BoneParents;
 			BoneParents.SetNumUninitialized(BoneArray->Num());
 
 			for (int32 BoneIndex = 0; BoneIndex < BoneArray->Num(); ++BoneIndex)
@@ -282,20 +810,11 @@ void FOmniverseLiveLinkListener::ProcessAnimationData(const TSharedPtr<FJsonObje
 					return; // Invalid Json Format
 				}
 			}
-
-			NewSkeletonData->SetBoneNames(BoneNames);
-			NewSkeletonData->SetBoneParents(BoneParents);
 		}
 
-		if (Facial) // Facial need the static curve name
-		{
-			NewSkeletonData->PropertyNames = ExpNames;
-		}
-		FLiveLinkSubjectKey Key = FLiveLinkSubjectKey(SourceGuid, InSubjectName);
-		LiveLinkClient->RemoveSubject_AnyThread(Key);
-		LiveLinkClient->PushSubjectStaticData_AnyThread(Key, ULiveLinkAnimationRole::StaticClass(), MoveTemp(StaticData));
+		PushStaticData(InSubjectName, BoneNames, BoneParents, ExpNames, CurveNamesHash);
 	}
-	UsingSubjects.Add(InSubjectName, true);
+	MarkSubjectUsed(InSubjectName, InConnectionId);
 
 	FLiveLinkFrameDataStruct AnimationStruct(FLiveLinkAnimationFrameData::StaticStruct());
 	FLiveLinkAnimationFrameData& NewData = *AnimationStruct.Cast<FLiveLinkAnimationFrameData>();
@@ -313,7 +832,7 @@ void FOmniverseLiveLinkListener::ProcessAnimationData(const TSharedPtr<FJsonObje
 			const TSharedPtr<FJsonObject> BoneObject = BoneValue->AsObject();
 
 			const TArray<TSharedPtr<FJsonValue>>* LocationArray = nullptr;
-			FVector BoneLocation;
+			FVector3f BoneLocation;
 
 			if (BoneObject->TryGetArrayField(TEXT("Location"), LocationArray)
 				&& LocationArray->Num() == 3) // X, Y, Z
@@ -321,7 +840,7 @@ void FOmniverseLiveLinkListener::ProcessAnimationData(const TSharedPtr<FJsonObje
 				double X = (*LocationArray)[0]->AsNumber();
 				double Y = (*LocationArray)[1]->AsNumber();
 				double Z = (*LocationArray)[2]->AsNumber();
-				BoneLocation = FVector(X, -Y, Z);
+				BoneLocation = FVector3f(X, Y, Z);
 			}
 			else
 			{
@@ -330,7 +849,7 @@ void FOmniverseLiveLinkListener::ProcessAnimationData(const TSharedPtr<FJsonObje
 			}
 
 			const TArray<TSharedPtr<FJsonValue>>* RotationArray = nullptr;
-			FQuat BoneQuat;
+			FQuat4f BoneQuat;
 			if (BoneObject->TryGetArrayField(TEXT("Rotation"), RotationArray)
 				&& RotationArray->Num() == 4) // X, Y, Z, W
 			{
@@ -338,17 +857,16 @@ void FOmniverseLiveLinkListener::ProcessAnimationData(const TSharedPtr<FJsonObje
 				double Y = (*RotationArray)[1]->AsNumber();
 				double Z = (*RotationArray)[2]->AsNumber();
 				double W = (*RotationArray)[3]->AsNumber();
-				FVector RightVec = FQuat(X, Y, Z, W).Euler();
-				FVector LeftVec = FVector(-RightVec.X, RightVec.Y, -RightVec.Z);
-				BoneQuat = FQuat::MakeFromEuler(LeftVec);
+				BoneQuat = FQuat4f(X, Y, Z, W);
 			}
 			else
 			{
 				// Invalid Json Format
 				return;
 			}
-			DataTransforms[BoneIndex] = FTransform(BoneQuat, BoneLocation);
+			DataTransforms[BoneIndex] = FTransform(FQuat(BoneQuat), FVector(BoneLocation));
 		}
+		ConvertBoneTransforms(DataTransforms);
 	}
 
 	if (Facial && ExpNames.Num() > 0)
@@ -370,8 +888,7 @@ void FOmniverseLiveLinkListener::ProcessAnimationData(const TSharedPtr<FJsonObje
 		}
 	}
 
-	FLiveLinkSubjectKey SubjectKey(SourceGuid, InSubjectName);
-	LiveLinkClient->PushSubjectFrameData_AnyThread(SubjectKey, MoveTemp(AnimationStruct));
+	PushFrameData(InSubjectName, MoveTemp(AnimationStruct));
 }
 
 
@@ -9,6 +9,9 @@
 #pragma once
 #include "CoreMinimal.h"
 #include "OmniverseBaseListener.h"
+#include "OmniverseJsonFrameDecoder.h"
+#include "OmniverseFrameInterpolator.h"
+#include "HAL/ThreadSafeBool.h"
 
 
 class FOmniverseLiveLinkListener : public FOmniverseBaseListener
@@ -17,22 +20,94 @@ public:
 	FOmniverseLiveLinkListener(uint32 InPort);
 	virtual ~FOmniverseLiveLinkListener();
 
-	virtual void OnPackageDataReceived(const uint8* InPackageData, int32 InPackageSize) override;
-	virtual void OnPackageDataPushed(const uint8* InPackageData, int32 InPackageSize, double DeltaTime, bool bBegin = false, bool bEnd = false) override;
+	virtual void OnPackageDataReceived(const uint8* InPackageData, int32 InPackageSize, uint32 InConnectionId) override;
+	virtual void OnPackageDataPushed(const uint8* InPackageData, int32 InPackageSize, uint32 InConnectionId, double DeltaTime, bool bBegin = false, bool bEnd = false) override;
+	virtual void OnConnectionClosed(uint32 InConnectionId) override;
+	virtual void OnInterrupt() override;
 	virtual uint32 GetDelayTime() const override;
 	virtual bool IsHeaderPackage(const uint8* InPackageData, int32 InPackageSize) const override;
 	virtual bool GetFPSInHeader(const uint8* InPackageData, int32 InPackageSize, double& OutFPS) const override;
 
 	void ClearAllSubjects();
 
+	// Frames are blended to the engine rate instead of pushed as they're played
+	void SetInterpolateFrames(bool bInInterpolateFrames) { bInterpolateFrames = bInInterpolateFrames; }
+	// Game thread: push the blended frames of this tick
+	void TickInterpolation();
+	// LiveLink evaluates the frames by their time stamps (engine time or timecode mode), they're pushed as they arrive
+	// instead of played by the frame player
+	void SetTimedEvaluation(bool bInTimedEvaluation) { bTimedEvaluation = bInTimedEvaluation; }
+
 private:
-	void ResetUsingSubjects();
-	void RemoveUnusedSubjects();
-	void ProcessAnimationData(const TSharedPtr<class FJsonObject>& DataObject, const FName& InSubjectName);
-	bool ParseJSON(const uint8* InPackageData, int32 InPackageSize);
+	void ResetUsingSubjects(uint32 InConnectionId);
+	void RemoveUnusedSubjects(uint32 InConnectionId);
+	bool IsSubjectUsed(const FName& InSubjectName, uint32 InExceptConnectionId = MAX_uint32) const;
+	void MarkSubjectUsed(const FName& InSubjectName, uint32 InConnectionId);
+	void PushStaticData(const FName& InSubjectName, const TArray<FName>& InBoneNames, const TArray<int32>& InBoneParents, const TArray<FName>& InCurveNames, uint32 InCurveNamesHash);
+	// The number of bones or curves is INDEX_NONE if they're not sent
+	bool NeedsNewStaticData(const FName& InSubjectName, int32 InNumBones, int32 InNumCurves, uint32 InCurveNamesHash) const;
+	void ProcessAnimationData(const TSharedPtr<class FJsonObject>& DataObject, const FName& InSubjectName, uint32 InConnectionId);
+	void ProcessDecodedSubject(const FOmniverseJsonFrameDecoder::FSubject& InSubject, uint32 InConnectionId);
+	void ParsePackage(const uint8* InPackageData, int32 InPackageSize, uint32 InConnectionId);
+	bool ParseJSON(const uint8* InPackageData, int32 InPackageSize, uint32 InConnectionId);
+	// To LiveLink, or to the interpolator which pushes on the game thread
+	void PushFrameData(const FName& InSubjectName, FLiveLinkFrameDataStruct&& InFrameData);
+
+	// Binary stream: the header is "A2F:<FPS>:BIN", a NUL, then the subject name, bone names and parents, curve names.
+	// Each frame is the magic "BFRM", a frame index, then the packed float transforms and weights, see simple_socket_sender.py
+	bool IsBinaryFrame(const uint8* InPackageData, int32 InPackageSize) const;
+	bool ParseBinaryHeader(const uint8* InPackageData, int32 InPackageSize, uint32 InConnectionId);
+	bool ParseBinaryFrame(const uint8* InPackageData, int32 InPackageSize, uint32 InConnectionId);
+
+	// A2F coordinates to Unreal, in place over all the bones of a frame
+	static void ConvertBoneTransforms(TArray<FTransform>& InOutTransforms);
+	// World time and the engine timecode at the presentation time of a frame
+	static void StampFrameTime(FLiveLinkBaseFrameData& InOutFrame, double InPresentationTime);
 
 private:
+	// Names of a binary stream, sent once in its header
+	struct FBinaryStreamLayout
+	{
+		FName SubjectName;
+		int32 NumBones = 0;
+		int32 NumCurves = 0;
+	};
+
+	// Presentation time of the stream of a connection, the stream start plus the frame index over the FPS of its header.
+	// The frame index is the one of the binary frames, counted for the JSON frames
+	struct FStreamTimeline
+	{
+		double StartTime = 0.0;
+		// 0 when the header has no FPS, the frames are then timed by their pending time
+		double FrameRate = 0.0;
+		int64 NextFrameIndex = 0;
+		double PresentationTime = 0.0;
+	};
+
+	// Static data last pushed for a subject, compared to each frame instead of evaluating the subject in LiveLink
+	struct FStaticDataSignature
+	{
+		int32 NumBones = 0;
+		int32 NumCurves = 0;
+		uint32 CurveNamesHash = 0;
+	};
 
-	// List of subjects in using
-	TMap<FName, bool> UsingSubjects;
+	// List of subjects in using for each connection, subjects of the closed connections are kept with id 0
+	TMap<uint32, TMap<FName, bool>> ConnectionSubjects;
+	TMap<FName, FStaticDataSignature> StaticDataSignatures;
+	// Reused for every JSON frame, only in the SubjectsLock
+	FOmniverseJsonFrameDecoder JsonDecoder;
+	// Layout of the binary stream for each connection
+	TMap<uint32, FBinaryStreamLayout> BinaryLayouts;
+	FOmniverseFrameInterpolator Interpolator;
+	FThreadSafeBool bInterpolateFrames = false;
+	// Streams of the timed evaluation for each connection
+	TMap<uint32, FStreamTimeline> StreamTimelines;
+	FThreadSafeBool bTimedEvaluation = false;
+	// Bones of the last frame of each subject, kept by the neutral pose of an interrupt
+	TMap<FName, TArray<FTransform>> LastTransforms;
+	// Presentation time of the package being parsed, only in the SubjectsLock
+	double FramePresentationTime = 0.0;
+	// Packages are parsed in both socket and frame player threads
+	mutable FCriticalSection SubjectsLock;
 };
@@ -10,6 +10,7 @@
 #include "OmniverseWaveStreamer.h"
 #include "OmniverseLiveLinkListener.h"
 #include "OmniverseLiveLinkSourceSettings.h"
+#include "OmniverseFrameScheduler.h"
 
 #include "ILiveLinkClient.h"
 #include "Logging/LogMacros.h"
@@ -20,12 +21,16 @@
 FOmniverseLiveLinkSource::FOmniverseLiveLinkSource(uint32 InPort, uint32 InAudioPort, uint32 InSampleRate)
 {
 	SourceStatus = LOCTEXT("OmniverseLiveLinkSource", "Device Not Found");
-	FOmniverseLiveLinkFramePlayer::Get().Start();
+	FramePlayer = MakeShared<FOmniverseLiveLinkFramePlayer, ESPMode::ThreadSafe>();
+	FOmniverseFrameScheduler::Get().RegisterPlayer(FramePlayer);
+	FOmniverseFrameScheduler::Get().Start();
 	WaveStreamer = MakeShareable(new FOmniverseWaveStreamer(InAudioPort, InSampleRate));
 	LiveLinkListener = MakeShareable(new FOmniverseLiveLinkListener(InPort));
 
-	FOmniverseLiveLinkFramePlayer::Get().RegisterAnime(LiveLinkListener);
-	FOmniverseLiveLinkFramePlayer::Get().RegisterAudio(WaveStreamer);
+	WaveStreamer->SetFramePlayer(FramePlayer);
+	LiveLinkListener->SetFramePlayer(FramePlayer);
+	FramePlayer->RegisterAnime(LiveLinkListener);
+	FramePlayer->RegisterAudio(WaveStreamer);
 
 	if (LiveLinkListener->IsSocketReady() && WaveStreamer->IsSocketReady())
 	{
@@ -36,7 +41,8 @@ FOmniverseLiveLinkSource::FOmniverseLiveLinkSource(uint32 InPort, uint32 InAudio
 
 FOmniverseLiveLinkSource::~FOmniverseLiveLinkSource()
 {
-	FOmniverseLiveLinkFramePlayer::Get().Reset();
+	FOmniverseFrameScheduler::Get().UnregisterPlayer(FramePlayer);
+	FramePlayer->Reset();
     Stop();
 
 	WaveStreamer.Reset();
@@ -65,10 +71,36 @@ FText FOmniverseLiveLinkSource::GetSourceType() const
 
 void FOmniverseLiveLinkSource::ReceiveClient( ILiveLinkClient* InClient, FGuid InSourceGuid )
 {
+	LiveLinkClient = InClient;
+	SourceGuid = InSourceGuid;
 	LiveLinkListener->SetClient(InClient, InSourceGuid);
 	WaveStreamer->SetClient(InClient, InSourceGuid);
 }
 
+void FOmniverseLiveLinkSource::Update()
+{
+	// Show the adaptive delay in the source settings
+	UOmniverseLiveLinkSourceSettings* Settings = LiveLinkClient ? Cast<UOmniverseLiveLinkSourceSettings>(LiveLinkClient->GetSourceSettings(SourceGuid)) : nullptr;
+	if (Settings)
+	{
+		LiveLinkListener->SetInterpolateFrames(Settings->bInterpolateFrames);
+		LiveLinkListener->SetTimedEvaluation(Settings->Mode != ELiveLinkSourceMode::Latest);
+		FramePlayer->SetInterpolatedAnime(Settings->bInterpolateFrames && Settings->Mode == ELiveLinkSourceMode::Latest);
+
+		const FOmniverseJitterBuffer::FStats AnimeStats = FramePlayer->GetAnimeJitterBuffer().GetStats();
+		Settings->CurrentAnimationDelayTime = Settings->bAdaptiveDelay ? AnimeStats.Delay * 1000.0 : Settings->AnimationDelayTime;
+		Settings->AnimationJitter = AnimeStats.Jitter * 1000.0;
+		Settings->LateAnimationFrames = AnimeStats.LateFrames;
+
+		const FOmniverseJitterBuffer::FStats AudioStats = FramePlayer->GetAudioJitterBuffer().GetStats();
+		Settings->CurrentAudioDelayTime = Settings->bAdaptiveDelay ? AudioStats.Delay * 1000.0 : Settings->AudioDelayTime;
+		Settings->AudioJitter = AudioStats.Jitter * 1000.0;
+		Settings->LateAudioPackages = AudioStats.LateFrames;
+	}
+
+	LiveLinkListener->TickInterpolation();
+}
+
 bool FOmniverseLiveLinkSource::IsSourceStillValid() const
 {
     // Source is valid if we have a valid thread and socket
@@ -26,6 +26,7 @@ public:
 	virtual FText GetSourceMachineName() const override;
 	virtual FText GetSourceStatus() const override;
 	virtual TSubclassOf<ULiveLinkSourceSettings> GetSettingsClass() const override;
+	virtual void Update() override;
     // End ILiveLinkSource Interface
 
 private:
@@ -36,6 +37,11 @@ private:
     
 	TSharedPtr<class FOmniverseWaveStreamer, ESPMode::ThreadSafe> WaveStreamer;
 	TSharedPtr<class FOmniverseLiveLinkListener, ESPMode::ThreadSafe> LiveLinkListener;
+	// Own timeline, so the sources don't block each other
+	TSharedPtr<class FOmniverseLiveLinkFramePlayer, ESPMode::ThreadSafe> FramePlayer;
 
 	FText SourceStatus;
+
+	class ILiveLinkClient* LiveLinkClient = nullptr;
+	FGuid SourceGuid;
 };
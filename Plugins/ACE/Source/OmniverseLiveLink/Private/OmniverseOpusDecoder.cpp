@@ -0,0 +1,76 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "OmniverseOpusDecoder.h"
+#include "ACEPrivate.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "opus.h"
+THIRD_PARTY_INCLUDES_END
+
+// Longest Opus packet in milliseconds
+#define OPUS_MAX_PACKET_MS 120
+
+
+FOmniverseOpusDecoder::~FOmniverseOpusDecoder()
+{
+	if (Decoder)
+	{
+		opus_decoder_destroy(Decoder);
+	}
+}
+
+bool FOmniverseOpusDecoder::IsSupportedSampleRate(int32 InSampleRate)
+{
+	return InSampleRate == 8000 || InSampleRate == 12000 || InSampleRate == 16000 || InSampleRate == 24000 || InSampleRate == 48000;
+}
+
+bool FOmniverseOpusDecoder::Init(int32 InSampleRate, int32 InNumChannels)
+{
+	if (!IsSupportedSampleRate(InSampleRate) || (InNumChannels != 1 && InNumChannels != 2))
+	{
+		UE_LOG(LogACE, Warning, TEXT("Opus stream of %d Hz and %d channels is not supported."), InSampleRate, InNumChannels);
+		return false;
+	}
+
+	int32 Error = OPUS_OK;
+	Decoder = opus_decoder_create(InSampleRate, InNumChannels, &Error);
+	if (Error != OPUS_OK || Decoder == nullptr)
+	{
+		UE_LOG(LogACE, Warning, TEXT("Failed to create the Opus decoder: %s"), ANSI_TO_TCHAR(opus_strerror(Error)));
+		Decoder = nullptr;
+		return false;
+	}
+
+	NumChannels = InNumChannels;
+	MaxFrames = InSampleRate * OPUS_MAX_PACKET_MS / 1000;
+	DecodeBuffer.SetNumUninitialized(MaxFrames * NumChannels);
+	return true;
+}
+
+int32 FOmniverseOpusDecoder::Decode(const uint8* InPacket, int32 InSize, const float*& OutAudio)
+{
+	OutAudio = DecodeBuffer.GetData();
+	if (Decoder == nullptr)
+	{
+		return 0;
+	}
+
+	int32 NumFrames = opus_decode_float(Decoder, InPacket, InSize, DecodeBuffer.GetData(), MaxFrames, 0);
+	if (NumFrames < 0)
+	{
+		UE_LOG(LogACE, Verbose, TEXT("Opus packet of %d bytes not decoded: %s"), InSize, ANSI_TO_TCHAR(opus_strerror(NumFrames)));
+		// Packet loss concealment for the duration of the last packet
+		NumFrames = LastNumFrames > 0 ? FMath::Max(opus_decode_float(Decoder, nullptr, 0, DecodeBuffer.GetData(), LastNumFrames, 0), 0) : 0;
+	}
+	else
+	{
+		LastNumFrames = NumFrames;
+	}
+	return NumFrames;
+}
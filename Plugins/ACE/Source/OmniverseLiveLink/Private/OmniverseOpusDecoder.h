@@ -0,0 +1,35 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+#include "CoreMinimal.h"
+
+// Decoder state of an Opus stream of a connection, from its header to the next one. Each package of the stream is one Opus packet,
+// decoded to interleaved float frames on the socket thread before it's queued for playback
+class FOmniverseOpusDecoder
+{
+public:
+	~FOmniverseOpusDecoder();
+
+	// Opus rates only: 8, 12, 16, 24 or 48 kHz, mono or stereo
+	bool Init(int32 InSampleRate, int32 InNumChannels);
+	// Decoded frames of the packet, valid until the next call. A corrupt packet is concealed from the previous ones
+	int32 Decode(const uint8* InPacket, int32 InSize, const float*& OutAudio);
+
+	int32 GetNumChannels() const { return NumChannels; }
+
+	static bool IsSupportedSampleRate(int32 InSampleRate);
+
+private:
+	struct OpusDecoder* Decoder = nullptr;
+	int32 NumChannels = 0;
+	// Largest Opus packet, 120 ms, allocated once per stream
+	TArray<float> DecodeBuffer;
+	int32 MaxFrames = 0;
+	int32 LastNumFrames = 0;
+};
@@ -0,0 +1,122 @@
+// Copyright(c) 2022-2023, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "OmniversePackageFramer.h"
+
+#define PACKAGE_HEADER_SIZE 8
+
+
+static uint64 BytesToSize(const uint8* Bytes)
+{
+	uint64 Return = 0;
+	for (int32 Index = 0; Index < PACKAGE_HEADER_SIZE; ++Index)
+	{
+		Return = (Return << 8) | Bytes[Index];
+	}
+	return Return;
+}
+
+FOmniversePackageFramer::FOmniversePackageFramer(int32 InCapacity, int32 InMaxPackageSize)
+	: MaxPackageSize(InMaxPackageSize)
+{
+	Buffer.SetNumUninitialized(InCapacity);
+}
+
+void FOmniversePackageFramer::Reserve(int32 InMinFreeSize)
+{
+	// Everything is consumed, restart from the beginning without copying
+	if (ReadOffset == WriteOffset)
+	{
+		ReadOffset = 0;
+		WriteOffset = 0;
+	}
+
+	if (Buffer.Num() - WriteOffset >= InMinFreeSize)
+	{
+		return;
+	}
+
+	// Move the only unconsumed (incomplete) package to the front, once per receive
+	const int32 UnconsumedSize = WriteOffset - ReadOffset;
+	if (ReadOffset > 0)
+	{
+		FMemory::Memmove(Buffer.GetData(), Buffer.GetData() + ReadOffset, UnconsumedSize);
+		ReadOffset = 0;
+		WriteOffset = UnconsumedSize;
+	}
+
+	// Grow for the package larger than the buffer, it's limited by MaxPackageSize
+	int32 RequiredSize = WriteOffset + InMinFreeSize;
+	if (DataSizeInHeader.IsSet())
+	{
+		RequiredSize = FMath::Max(RequiredSize, DataSizeInHeader.GetValue());
+	}
+	if (RequiredSize > Buffer.Num())
+	{
+		Buffer.SetNumUninitialized(RequiredSize);
+	}
+}
+
+uint8* FOmniversePackageFramer::GetWriteBuffer(int32 InMinFreeSize, int32& OutFreeSize)
+{
+	Reserve(InMinFreeSize);
+	OutFreeSize = Buffer.Num() - WriteOffset;
+	return Buffer.GetData() + WriteOffset;
+}
+
+void FOmniversePackageFramer::CommitWrite(int32 InWrittenSize)
+{
+	check(WriteOffset + InWrittenSize <= Buffer.Num());
+	WriteOffset += InWrittenSize;
+}
+
+bool FOmniversePackageFramer::NextPackage(const uint8*& OutPackageData, int32& OutPackageSize)
+{
+	if (bInvalidHeader)
+	{
+		return false;
+	}
+
+	if (!DataSizeInHeader.IsSet())
+	{
+		if (WriteOffset - ReadOffset < PACKAGE_HEADER_SIZE)
+		{
+			return false;
+		}
+
+		const uint64 PackageSize = BytesToSize(Buffer.GetData() + ReadOffset);
+		if (PackageSize > (uint64)MaxPackageSize)
+		{
+			bInvalidHeader = true;
+			return false;
+		}
+
+		DataSizeInHeader = (int32)PackageSize;
+		ReadOffset += PACKAGE_HEADER_SIZE;
+	}
+
+	// This's the incomplete data, need to be completed next time
+	if (WriteOffset - ReadOffset < DataSizeInHeader.GetValue())
+	{
+		return false;
+	}
+
+	OutPackageData = Buffer.GetData() + ReadOffset;
+	OutPackageSize = DataSizeInHeader.GetValue();
+	ReadOffset += OutPackageSize;
+	DataSizeInHeader.Reset();
+	return true;
+}
+
+void FOmniversePackageFramer::Reset()
+{
+	ReadOffset = 0;
+	WriteOffset = 0;
+	DataSizeInHeader.Reset();
+	bInvalidHeader = false;
+}
@@ -0,0 +1,43 @@
+// Copyright(c) 2022-2023, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+#include "CoreMinimal.h"
+
+// Splits the socket stream into packages, each one is an 8 bytes big-endian size followed by the payload.
+// Socket data is received straight into the framer and complete packages are handed out as views of its buffer,
+// so packages are never copied or shifted one by one.
+class FOmniversePackageFramer
+{
+public:
+	FOmniversePackageFramer(int32 InCapacity, int32 InMaxPackageSize);
+
+	// Get the writable space for the next receive, at least InMinFreeSize bytes
+	uint8* GetWriteBuffer(int32 InMinFreeSize, int32& OutFreeSize);
+	// Commit the bytes received into the buffer from GetWriteBuffer()
+	void CommitWrite(int32 InWrittenSize);
+
+	// Get the next complete package, the view is valid until the next GetWriteBuffer()
+	bool NextPackage(const uint8*& OutPackageData, int32& OutPackageSize);
+
+	// The size in header is out of range, the stream can't be framed anymore
+	bool HasError() const { return bInvalidHeader; }
+	void Reset();
+
+private:
+	void Reserve(int32 InMinFreeSize);
+
+	TArray<uint8> Buffer;
+	// Only data between ReadOffset and WriteOffset isn't consumed
+	int32 ReadOffset = 0;
+	int32 WriteOffset = 0;
+	TOptional<int32> DataSizeInHeader;
+
+	int32 MaxPackageSize;
+	bool bInvalidHeader = false;
+};
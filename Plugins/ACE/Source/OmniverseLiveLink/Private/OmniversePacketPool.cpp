@@ -0,0 +1,71 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "OmniversePacketPool.h"
+#include "OmniverseRenderCheck.h"
+#include "ACEPrivate.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Packets In Use"), STAT_OmniversePacketsInUse, STATGROUP_ACE);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Packet Pool High Water Mark"), STAT_OmniversePacketPoolHighWaterMark, STATGROUP_ACE);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Packet Pool Size"), STAT_OmniversePacketPoolSize, STATGROUP_ACE);
+
+
+FOmniversePacketPool::FOmniversePacketPool(int32 InNumPackets)
+{
+	Packets.Reserve(InNumPackets);
+	FreePackets.Reserve(InNumPackets);
+	for (int32 Index = 0; Index < InNumPackets; ++Index)
+	{
+		FreePackets.Add(Packets.Add_GetRef(MakeUnique<FOmniversePacket>()).Get());
+	}
+	SET_DWORD_STAT(STAT_OmniversePacketPoolSize, Packets.Num());
+}
+
+FOmniversePacket* FOmniversePacketPool::Acquire(const uint8* InData, int32 InSize)
+{
+	FOmniversePacket* Packet = nullptr;
+	{
+		FOmniverseScopeLock Lock(&PoolLock);
+		if (FreePackets.Num() > 0)
+		{
+			Packet = FreePackets.Pop(false);
+		}
+		else
+		{
+			Packet = Packets.Add_GetRef(MakeUnique<FOmniversePacket>()).Get();
+			FreePackets.Reserve(Packets.Num());
+			SET_DWORD_STAT(STAT_OmniversePacketPoolSize, Packets.Num());
+		}
+
+		++NumInUse;
+		if (NumInUse > HighWaterMark)
+		{
+			HighWaterMark = NumInUse;
+			SET_DWORD_STAT(STAT_OmniversePacketPoolHighWaterMark, HighWaterMark);
+		}
+		SET_DWORD_STAT(STAT_OmniversePacketsInUse, NumInUse);
+	}
+
+	// Only grows to the largest package
+	Packet->Data.SetNumUninitialized(InSize, false);
+	FMemory::Memcpy(Packet->Data.GetData(), InData, InSize);
+	return Packet;
+}
+
+void FOmniversePacketPool::Release(FOmniversePacket* InPacket)
+{
+	if (InPacket == nullptr)
+	{
+		return;
+	}
+
+	FOmniverseScopeLock Lock(&PoolLock);
+	FreePackets.Add(InPacket);
+	--NumInUse;
+	SET_DWORD_STAT(STAT_OmniversePacketsInUse, NumInUse);
+}
@@ -0,0 +1,36 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+#include "CoreMinimal.h"
+
+// Payload of a package waiting in the frame player, the buffer keeps its capacity when it's returned to the pool
+struct FOmniversePacket
+{
+	TArray<uint8> Data;
+};
+
+// Fixed set of packets preallocated at start, grows only when more packets are in flight than ever before.
+// Packets are handed out by pointer, the only owner returns them with Release()
+class FOmniversePacketPool
+{
+public:
+	FOmniversePacketPool(int32 InNumPackets);
+
+	FOmniversePacket* Acquire(const uint8* InData, int32 InSize);
+	void Release(FOmniversePacket* InPacket);
+
+	int32 GetHighWaterMark() const { return HighWaterMark; }
+
+private:
+	TArray<TUniquePtr<FOmniversePacket>> Packets;
+	TArray<FOmniversePacket*> FreePackets;
+	int32 NumInUse = 0;
+	int32 HighWaterMark = 0;
+	FCriticalSection PoolLock;
+};
@@ -0,0 +1,64 @@
+// Copyright(c) 2022-2023, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "Misc/ScopeLock.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+// Test hook of the audio render path. While a check runs on a thread, the locks the plugin takes on it are counted.
+// The render buffers are identified by their allocations, a buffer grown by Render() changes its hash
+class FOmniverseRenderCheck
+{
+public:
+	static void Begin()
+	{
+		NumLocks = 0;
+		bChecking = true;
+	}
+
+	// The locks taken on the thread since Begin()
+	static int32 End()
+	{
+		bChecking = false;
+		return NumLocks;
+	}
+
+	static void CountLock()
+	{
+		if (bChecking)
+		{
+			++NumLocks;
+		}
+	}
+
+	template <typename ArrayType>
+	static uint32 HashBuffer(const ArrayType& InBuffer, uint32 InHash)
+	{
+		const UPTRINT Allocation[] = { (UPTRINT)InBuffer.GetData(), (UPTRINT)InBuffer.Max() };
+		return FCrc::MemCrc32(Allocation, sizeof(Allocation), InHash);
+	}
+
+private:
+	static inline thread_local bool bChecking = false;
+	static inline thread_local int32 NumLocks = 0;
+};
+#endif // WITH_DEV_AUTOMATION_TESTS
+
+// Every lock of the plugin, counted by the render check
+class FOmniverseScopeLock : public FScopeLock
+{
+public:
+	explicit FOmniverseScopeLock(FCriticalSection* InSynchObject)
+		: FScopeLock(InSynchObject)
+	{
+#if WITH_DEV_AUTOMATION_TESTS
+		FOmniverseRenderCheck::CountLock();
+#endif
+	}
+};
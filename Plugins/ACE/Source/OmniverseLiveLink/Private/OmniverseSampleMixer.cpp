@@ -0,0 +1,329 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "OmniverseSampleMixer.h"
+#include "HAL/IConsoleManager.h"
+#include "ACEPrivate.h"
+
+namespace
+{
+	// Stream sample to float, PCM is scaled to [-1, 1]
+	template<typename SampleType>
+	struct TSampleFormat;
+
+	template<>
+	struct TSampleFormat<float>
+	{
+		static FORCEINLINE float Load(const float* InSamples)
+		{
+			return *InSamples;
+		}
+
+		static FORCEINLINE VectorRegister4Float Load4(const float* InSamples)
+		{
+			return VectorLoad(InSamples);
+		}
+	};
+
+	template<>
+	struct TSampleFormat<double>
+	{
+		static FORCEINLINE float Load(const double* InSamples)
+		{
+			return (float)*InSamples;
+		}
+
+		static FORCEINLINE VectorRegister4Float Load4(const double* InSamples)
+		{
+			return MakeVectorRegisterFloat((float)InSamples[0], (float)InSamples[1], (float)InSamples[2], (float)InSamples[3]);
+		}
+	};
+
+	template<typename IntType>
+	struct TPcmFormat
+	{
+		static FORCEINLINE float Load(const IntType* InSamples)
+		{
+			const float Sample = *InSamples;
+			return Sample * (Sample >= 0.0f ? 1.0f / TNumericLimits<IntType>::Max() : 1.0f / (TNumericLimits<IntType>::Max() + 1.0f));
+		}
+
+		static FORCEINLINE VectorRegister4Float Load4(const IntType* InSamples)
+		{
+			const VectorRegister4Float Samples = MakeVectorRegisterFloat((float)InSamples[0], (float)InSamples[1], (float)InSamples[2], (float)InSamples[3]);
+			const VectorRegister4Float PositiveScale = VectorSetFloat1(1.0f / TNumericLimits<IntType>::Max());
+			const VectorRegister4Float NegativeScale = VectorSetFloat1(1.0f / (TNumericLimits<IntType>::Max() + 1.0f));
+			return VectorMultiply(Samples, VectorSelect(VectorCompareGE(Samples, GlobalVectorConstants::FloatZero), PositiveScale, NegativeScale));
+		}
+	};
+
+	template<>
+	struct TSampleFormat<int16> : TPcmFormat<int16>
+	{
+	};
+
+	template<>
+	struct TSampleFormat<int8> : TPcmFormat<int8>
+	{
+	};
+
+	// Each stream sample to the same device sample, 4 at a time
+	template<typename SampleType>
+	void MixStereoToStereo(const SampleType* InSamples, int32 InNumSamples, float* OutAudio, int32 InNumOutSamples)
+	{
+		const int32 NumSamples = FMath::Min(InNumSamples, InNumOutSamples);
+		int32 Index = 0;
+		for (; Index + 4 <= NumSamples; Index += 4)
+		{
+			VectorStore(VectorAdd(VectorLoad(OutAudio + Index), TSampleFormat<SampleType>::Load4(InSamples + Index)), OutAudio + Index);
+		}
+
+		for (; Index < NumSamples; ++Index)
+		{
+			OutAudio[Index] += TSampleFormat<SampleType>::Load(InSamples + Index);
+		}
+	}
+
+	// Each stream sample duplicated to both device channels, 4 stream samples to 8 device samples at a time
+	template<typename SampleType>
+	void MixMonoToStereo(const SampleType* InSamples, int32 InNumSamples, float* OutAudio, int32 InNumOutSamples)
+	{
+		const int32 NumSamples = FMath::Min(InNumSamples, InNumOutSamples / 2);
+		int32 Index = 0;
+		for (; Index + 4 <= NumSamples; Index += 4)
+		{
+			const VectorRegister4Float Mono = TSampleFormat<SampleType>::Load4(InSamples + Index);
+			float* Out = OutAudio + Index * 2;
+			VectorStore(VectorAdd(VectorLoad(Out), VectorSwizzle(Mono, 0, 0, 1, 1)), Out);
+			VectorStore(VectorAdd(VectorLoad(Out + 4), VectorSwizzle(Mono, 2, 2, 3, 3)), Out + 4);
+		}
+
+		for (; Index < NumSamples; ++Index)
+		{
+			const float Sample = TSampleFormat<SampleType>::Load(InSamples + Index);
+			OutAudio[Index * 2] += Sample;
+			OutAudio[Index * 2 + 1] += Sample;
+		}
+	}
+
+	template<typename SampleType, int32 NumStreamChannels>
+	void MixToDevice(const uint8* InData, int32 InNumSamples, float* OutAudio, int32 InNumOutSamples, int32 InNumOutChannels)
+	{
+		const SampleType* Samples = reinterpret_cast<const SampleType*>(InData);
+		if (InNumOutChannels == 2)
+		{
+			if (NumStreamChannels == 1)
+			{
+				MixMonoToStereo(Samples, InNumSamples, OutAudio, InNumOutSamples);
+			}
+			else
+			{
+				MixStereoToStereo(Samples, InNumSamples, OutAudio, InNumOutSamples);
+			}
+			return;
+		}
+		else if (InNumOutChannels == 1 && NumStreamChannels == 2)
+		{
+			// Mono output of a sound generator, both channels averaged
+			const int32 NumFrames = FMath::Min(InNumSamples / 2, InNumOutSamples);
+			for (int32 Index = 0; Index < NumFrames; ++Index)
+			{
+				OutAudio[Index] += 0.5f * (TSampleFormat<SampleType>::Load(Samples + Index * 2) + TSampleFormat<SampleType>::Load(Samples + Index * 2 + 1));
+			}
+			return;
+		}
+
+		// Other device layouts, the stream channels to the first device channels
+		for (int32 SampleIndex = 0, SourceSampleIndex = 0; SampleIndex < InNumOutSamples && SourceSampleIndex < InNumSamples; SampleIndex += InNumOutChannels)
+		{
+			for (int32 Channel = 0; Channel < InNumOutChannels && SampleIndex + Channel < InNumOutSamples && SourceSampleIndex < InNumSamples; ++Channel)
+			{
+				OutAudio[SampleIndex + Channel] += TSampleFormat<SampleType>::Load(Samples + SourceSampleIndex);
+
+				// Mono wave need duplicate the sample
+				if (NumStreamChannels < InNumOutChannels)
+				{
+					if (Channel == NumStreamChannels)
+					{
+						SourceSampleIndex++;
+					}
+				}
+				else
+				{
+					SourceSampleIndex++;
+				}
+			}
+		}
+	}
+
+	template<int32 NumStreamChannels>
+	FOmniverseMixFunction GetMixFunctionOfChannels(const FOmniverseWaveFormatInfo& InFormat)
+	{
+		if (InFormat.SampleType == 3 && InFormat.BitsPerSample == 32)
+		{
+			return &MixToDevice<float, NumStreamChannels>;
+		}
+		else if (InFormat.SampleType == 3 && InFormat.BitsPerSample == 64)
+		{
+			return &MixToDevice<double, NumStreamChannels>;
+		}
+		else if (InFormat.SampleType == 1 && InFormat.BitsPerSample == 16)
+		{
+			return &MixToDevice<int16, NumStreamChannels>;
+		}
+		else if (InFormat.SampleType == 1 && InFormat.BitsPerSample == 8)
+		{
+			return &MixToDevice<int8, NumStreamChannels>;
+		}
+		return nullptr;
+	}
+}
+
+FOmniverseMixFunction GetOmniverseMixFunction(const FOmniverseWaveFormatInfo& InFormat)
+{
+	if (InFormat.NumChannels == 1)
+	{
+		return GetMixFunctionOfChannels<1>(InFormat);
+	}
+	else if (InFormat.NumChannels == 2)
+	{
+		return GetMixFunctionOfChannels<2>(InFormat);
+	}
+	return nullptr;
+}
+
+void MixOmniverseVoice(const float* InAudio, float* OutAudio, int32 InNumSamples, float InGain)
+{
+	const VectorRegister4Float Gain = VectorSetFloat1(InGain);
+	int32 Index = 0;
+	for (; Index + 4 <= InNumSamples; Index += 4)
+	{
+		VectorStore(VectorMultiplyAdd(VectorLoad(InAudio + Index), Gain, VectorLoad(OutAudio + Index)), OutAudio + Index);
+	}
+	for (; Index < InNumSamples; ++Index)
+	{
+		OutAudio[Index] += InAudio[Index] * InGain;
+	}
+}
+
+#if !UE_BUILD_SHIPPING
+// Device buffer of the benchmark, stereo frames
+#define BENCHMARK_BUFFER_FRAMES 1024
+#define BENCHMARK_ITERATIONS 20
+
+// The per sample conversion the kernels replaced, the format is checked for every sample
+static void MixReference(const uint8* InData, int32 InNumSamples, float* OutAudio, int32 InNumOutSamples, int32 InNumOutChannels, const FOmniverseWaveFormatInfo& InFormat)
+{
+	const int32 Stride = InFormat.BitsPerSample / 8;
+	for (int32 SampleIndex = 0, SourceSampleIndex = 0; SampleIndex < InNumOutSamples; SampleIndex += InNumOutChannels)
+	{
+		for (int32 Channel = 0; Channel < InNumOutChannels; ++Channel)
+		{
+			const uint8* Sample = InData + SourceSampleIndex * Stride;
+			if (SourceSampleIndex < InNumSamples)
+			{
+				if (InFormat.BitsPerSample == 32 && InFormat.SampleType == 3)
+				{
+					OutAudio[SampleIndex + Channel] += *reinterpret_cast<const float*>(Sample);
+				}
+				else if (InFormat.BitsPerSample == 64 && InFormat.SampleType == 3)
+				{
+					OutAudio[SampleIndex + Channel] += (float)*reinterpret_cast<const double*>(Sample);
+				}
+				else if (InFormat.BitsPerSample == 16 && InFormat.SampleType == 1)
+				{
+					const int16 Value = *reinterpret_cast<const int16*>(Sample);
+					OutAudio[SampleIndex + Channel] += (float)Value / (Value >= 0 ? (float)MAX_int16 : ((float)MAX_int16 + 1));
+				}
+				else if (InFormat.BitsPerSample == 8 && InFormat.SampleType == 1)
+				{
+					const int8 Value = *reinterpret_cast<const int8*>(Sample);
+					OutAudio[SampleIndex + Channel] += (float)Value / (Value >= 0 ? (float)MAX_int8 : ((float)MAX_int8 + 1));
+				}
+			}
+
+			if (InFormat.NumChannels < InNumOutChannels)
+			{
+				if (Channel == InFormat.NumChannels)
+				{
+					SourceSampleIndex++;
+				}
+			}
+			else
+			{
+				SourceSampleIndex++;
+			}
+		}
+	}
+}
+
+// One second of each stream format mixed to a stereo device, by the reference loop and by the kernel
+static void BenchmarkSampleMixer()
+{
+	const int32 SampleRates[] = { 16000, 44100, 48000 };
+	const int32 Formats[][2] = { { 8, 1 }, { 16, 1 }, { 32, 3 }, { 64, 3 } };
+
+	TArray<float> OutAudio;
+	OutAudio.SetNumZeroed(BENCHMARK_BUFFER_FRAMES * 2);
+	for (int32 SampleRate : SampleRates)
+	{
+		for (const int32* Format : Formats)
+		{
+			for (int32 NumChannels = 1; NumChannels <= 2; ++NumChannels)
+			{
+				const FOmniverseWaveFormatInfo WaveFormat = { SampleRate, NumChannels, Format[0], Format[1] };
+				const FOmniverseMixFunction MixFunction = GetOmniverseMixFunction(WaveFormat);
+
+				const int32 Stride = WaveFormat.BitsPerSample / 8;
+				TArray<uint8> Stream;
+				Stream.SetNumUninitialized(SampleRate * NumChannels * Stride);
+				for (int32 Index = 0; Index < Stream.Num(); ++Index)
+				{
+					Stream[Index] = (uint8)FMath::Rand();
+				}
+				if (WaveFormat.SampleType == 3)
+				{
+					// Random bytes may be NaN or denormal floats
+					FMemory::Memzero(Stream.GetData(), Stream.Num());
+				}
+
+				const int32 BufferSamples = BENCHMARK_BUFFER_FRAMES * NumChannels;
+				uint64 ReferenceCycles = 0;
+				uint64 KernelCycles = 0;
+				for (int32 Iteration = 0; Iteration < BENCHMARK_ITERATIONS; ++Iteration)
+				{
+					for (int32 Offset = 0; Offset < SampleRate * NumChannels; Offset += BufferSamples)
+					{
+						const int32 NumSamples = FMath::Min(BufferSamples, SampleRate * NumChannels - Offset);
+						const int32 NumOutSamples = NumSamples / NumChannels * 2;
+
+						const uint64 ReferenceStart = FPlatformTime::Cycles64();
+						MixReference(Stream.GetData() + Offset * Stride, NumSamples, OutAudio.GetData(), NumOutSamples, 2, WaveFormat);
+						const uint64 KernelStart = FPlatformTime::Cycles64();
+						MixFunction(Stream.GetData() + Offset * Stride, NumSamples, OutAudio.GetData(), NumOutSamples, 2);
+						const uint64 KernelEnd = FPlatformTime::Cycles64();
+
+						ReferenceCycles += KernelStart - ReferenceStart;
+						KernelCycles += KernelEnd - KernelStart;
+					}
+				}
+
+				const double ReferenceMs = FPlatformTime::ToMilliseconds64(ReferenceCycles) / BENCHMARK_ITERATIONS;
+				const double KernelMs = FPlatformTime::ToMilliseconds64(KernelCycles) / BENCHMARK_ITERATIONS;
+				UE_LOG(LogACE, Display, TEXT("%d Hz, %d channels, %d bits type %d: reference %.3f ms, kernel %.3f ms per second of audio (x%.1f)"),
+					SampleRate, NumChannels, WaveFormat.BitsPerSample, WaveFormat.SampleType, ReferenceMs, KernelMs, KernelMs > 0.0 ? ReferenceMs / KernelMs : 0.0);
+			}
+		}
+	}
+}
+
+static FAutoConsoleCommand CmdOmniverseBenchmarkSampleMixer(
+	TEXT("omni.BenchmarkSampleMixer"),
+	TEXT("Compares the audio sample mixing kernels with the per sample conversion at 16 kHz, 44.1 kHz and 48 kHz.\n"),
+	FConsoleCommandDelegate::CreateStatic(&BenchmarkSampleMixer));
+#endif
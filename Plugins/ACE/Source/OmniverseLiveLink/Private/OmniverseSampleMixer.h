@@ -0,0 +1,22 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "OmniverseWaveDef.h"
+
+// Converts InNumSamples interleaved stream samples to float and adds them to the interleaved device buffer,
+// up to InNumOutSamples device samples
+typedef void (*FOmniverseMixFunction)(const uint8* InData, int32 InNumSamples, float* OutAudio, int32 InNumOutSamples, int32 InNumOutChannels);
+
+// Kernel specialized for the sample format and the channels of a stream, selected once for each wave.
+// Null if the format can't be played
+FOmniverseMixFunction GetOmniverseMixFunction(const FOmniverseWaveFormatInfo& InFormat);
+
+// Adds the float samples scaled by InGain to the device buffer, 4 at a time
+void MixOmniverseVoice(const float* InAudio, float* OutAudio, int32 InNumSamples, float InGain);
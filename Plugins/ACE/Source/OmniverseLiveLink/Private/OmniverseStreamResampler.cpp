@@ -0,0 +1,102 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "OmniverseStreamResampler.h"
+
+// Frames around the position used by the interpolation: one before it, two after it
+#define RESAMPLER_FRAMES_BEFORE 1
+#define RESAMPLER_FRAMES_AFTER 2
+
+void FOmniverseStreamResampler::Init(int32 InMaxChannels, int32 InMaxInputFrames)
+{
+	MaxInputFrames = InMaxInputFrames;
+	Input.SetNumZeroed(InMaxInputFrames * InMaxChannels);
+	NumChannels = InMaxChannels;
+	NumFrames = 0;
+}
+
+void FOmniverseStreamResampler::Reset(int32 InSourceRate, int32 InTargetRate, int32 InNumChannels)
+{
+	SourceRate = InSourceRate;
+	TargetRate = InTargetRate;
+	NumChannels = FMath::Clamp(InNumChannels, 1, MaxInputFrames > 0 ? Input.Num() / MaxInputFrames : 1);
+	Step = InTargetRate > 0 ? (double)InSourceRate / InTargetRate : 1.0;
+
+	// A silent frame before the first one of the stream
+	NumFrames = FMath::Min(RESAMPLER_FRAMES_BEFORE, MaxInputFrames);
+	FMemory::Memzero(Input.GetData(), NumFrames * NumChannels * sizeof(float));
+	Position = RESAMPLER_FRAMES_BEFORE;
+}
+
+bool FOmniverseStreamResampler::IsResampling(int32 InSourceRate, int32 InTargetRate, int32 InNumChannels) const
+{
+	return SourceRate == InSourceRate && TargetRate == InTargetRate && NumChannels == InNumChannels;
+}
+
+int32 FOmniverseStreamResampler::GetInputFramesNeeded(int32 InNumOutputFrames) const
+{
+	if (InNumOutputFrames <= 0)
+	{
+		return 0;
+	}
+
+	const double LastPosition = Position + (InNumOutputFrames - 1) * Step;
+	const int32 Needed = (int32)LastPosition + RESAMPLER_FRAMES_AFTER + 1 - NumFrames;
+	return FMath::Clamp(Needed, 0, MaxInputFrames - NumFrames);
+}
+
+float* FOmniverseStreamResampler::GetInputBuffer(int32 InNumFrames)
+{
+	float* Buffer = Input.GetData() + NumFrames * NumChannels;
+	FMemory::Memzero(Buffer, FMath::Min(InNumFrames, MaxInputFrames - NumFrames) * NumChannels * sizeof(float));
+	return Buffer;
+}
+
+void FOmniverseStreamResampler::CommitInput(int32 InNumFrames)
+{
+	NumFrames = FMath::Min(NumFrames + InNumFrames, MaxInputFrames);
+}
+
+int32 FOmniverseStreamResampler::Process(float* OutAudio, int32 InNumOutputFrames)
+{
+	int32 NumOutputFrames = 0;
+	for (; NumOutputFrames < InNumOutputFrames; ++NumOutputFrames)
+	{
+		const int32 Index = (int32)Position;
+		if (Index + RESAMPLER_FRAMES_AFTER >= NumFrames)
+		{
+			break;
+		}
+
+		const float Fraction = (float)(Position - Index);
+		const float* Frame = Input.GetData() + Index * NumChannels;
+		float* OutFrame = OutAudio + NumOutputFrames * NumChannels;
+		for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			const float Previous = Frame[Channel - NumChannels];
+			const float Current = Frame[Channel];
+			const float Next = Frame[Channel + NumChannels];
+			const float AfterNext = Frame[Channel + 2 * NumChannels];
+			OutFrame[Channel] = Current + 0.5f * Fraction * (Next - Previous
+				+ Fraction * (2.0f * Previous - 5.0f * Current + 4.0f * Next - AfterNext
+				+ Fraction * (3.0f * (Current - Next) + AfterNext - Previous)));
+		}
+		Position += Step;
+	}
+
+	// Only the frame before the next position is kept for the filter
+	const int32 Consumed = FMath::Min((int32)Position - RESAMPLER_FRAMES_BEFORE, NumFrames);
+	if (Consumed > 0)
+	{
+		FMemory::Memmove(Input.GetData(), Input.GetData() + Consumed * NumChannels, (NumFrames - Consumed) * NumChannels * sizeof(float));
+		NumFrames -= Consumed;
+		Position -= Consumed;
+	}
+
+	return NumOutputFrames;
+}
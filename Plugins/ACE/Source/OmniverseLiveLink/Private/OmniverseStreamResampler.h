@@ -0,0 +1,48 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "OmniverseRenderCheck.h"
+
+// Streaming resampler of the audio render thread, cubic (Catmull-Rom) interpolation of interleaved float frames.
+// The input frames not consumed yet and the fractional position are kept across the device buffers,
+// so a stream is resampled without discontinuity at the buffer edges. The latency is 2 source frames.
+// Nothing is allocated after Init()
+class FOmniverseStreamResampler
+{
+public:
+	void Init(int32 InMaxChannels, int32 InMaxInputFrames);
+	// New stream, the filter restarts from silence
+	void Reset(int32 InSourceRate, int32 InTargetRate, int32 InNumChannels);
+	bool IsResampling(int32 InSourceRate, int32 InTargetRate, int32 InNumChannels) const;
+
+	// Input frames to add before InNumOutputFrames can be produced, within the free input space
+	int32 GetInputFramesNeeded(int32 InNumOutputFrames) const;
+	// Zeroed space for the input frames, InNumFrames of them are added by CommitInput()
+	float* GetInputBuffer(int32 InNumFrames);
+	void CommitInput(int32 InNumFrames);
+
+	// Up to InNumOutputFrames interleaved frames, fewer if the input runs out. Returns the frames written
+	int32 Process(float* OutAudio, int32 InNumOutputFrames);
+
+#if WITH_DEV_AUTOMATION_TESTS
+	uint32 HashBuffers(uint32 InHash) const { return FOmniverseRenderCheck::HashBuffer(Input, InHash); }
+#endif
+
+private:
+	TArray<float> Input;
+	int32 MaxInputFrames = 0;
+	int32 NumFrames = 0;
+	int32 NumChannels = 0;
+	int32 SourceRate = 0;
+	int32 TargetRate = 0;
+	// Source frames per output frame, and the input position of the next output frame
+	double Step = 1.0;
+	double Position = 1.0;
+};
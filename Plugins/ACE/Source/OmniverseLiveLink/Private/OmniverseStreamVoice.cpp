@@ -0,0 +1,432 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "OmniverseStreamVoice.h"
+#include "AudioMixer.h"
+#include "HAL/IConsoleManager.h"
+
+// Stream channels the resampler holds, mono or stereo
+#define MAX_STREAM_CHANNELS 2
+// Source frames per device frame the resampler input holds, a 48 kHz stream to a 12 kHz device
+#define MAX_RESAMPLE_RATIO 4
+// Fade in after an underrun or at a stream boundary, fade out of the audio before them without concealment
+#define TRANSITION_FADE_SECONDS 0.005
+// Concealed audio after the stream runs dry, fading out
+#define CONCEALMENT_SECONDS 0.01
+// Frames of a tail, 10 ms at 96 kHz
+#define MAX_TAIL_FRAMES 960
+// A stream which ran dry for this long ended without its end marker, e.g. its connection was closed
+#define MAX_UNDERRUN_SECONDS 1.0
+
+
+static TAutoConsoleVariable<int32> CVarOmniverseAudioConcealment(
+	TEXT("omni.AudioConcealment"),
+	1,
+	TEXT("1 conceals an underrun of the audio stream with the last 10 ms mirrored and faded out, 0 only fades out the audio for 5 ms (default is 1).\n"),
+	ECVF_Default);
+
+// omni.AudioConcealment for the audio render thread, updated by the sink on the game thread
+static std::atomic<bool> GOmniverseAudioConcealment = true;
+
+static void OnAudioConcealmentChanged()
+{
+	GOmniverseAudioConcealment.store(CVarOmniverseAudioConcealment.GetValueOnGameThread() != 0, std::memory_order_relaxed);
+}
+
+static FAutoConsoleVariableSink CVarOmniverseAudioConcealmentSink(FConsoleCommandDelegate::CreateStatic(&OnAudioConcealmentChanged));
+
+
+static bool IsSupportedFormat(const FOmniverseWaveFormatInfo& Format)
+{
+	return (Format.SampleType == 1 || Format.SampleType == 3)
+		&& (Format.NumChannels == 1 || Format.NumChannels == 2)
+		&& Format.BitsPerSample >= 8
+		&& Format.SamplesPerSecond > 0;
+}
+
+FOmniverseStreamVoice::FOmniverseStreamVoice(int32 InRingCapacity)
+{
+	StreamRing.Init(InRingCapacity);
+}
+
+void FOmniverseStreamVoice::Activate(int32 InMaxBufferFrames)
+{
+	Resampler.Init(MAX_STREAM_CHANNELS, InMaxBufferFrames * MAX_RESAMPLE_RATIO);
+	bResetResampler = true;
+	HistoryBuffer.SetNumZeroed(MAX_TAIL_FRAMES * AUDIO_MIXER_MAX_OUTPUT_CHANNELS);
+	TailBuffer.SetNumZeroed(MAX_TAIL_FRAMES * AUDIO_MIXER_MAX_OUTPUT_CHANNELS);
+	HistoryFrames = 0;
+	TailFrames = 0;
+	TailPosition = 0;
+}
+
+void FOmniverseStreamVoice::BeginStream(const FOmniverseWaveFormatInfo& Format, uint32 ConnectionId)
+{
+	AppendingConnectionId = ConnectionId;
+	StreamRing.PushSegment({ Format, true });
+}
+
+bool FOmniverseStreamVoice::AppendStream(const uint8* Data, int32 Size, const FOmniverseWaveFormatInfo& Format, uint32 ConnectionId)
+{
+	if (!IsSupportedFormat(Format))
+	{
+		return true;
+	}
+
+	// The samples of another connection continue in their own format
+	if (ConnectionId != AppendingConnectionId)
+	{
+		AppendingConnectionId = ConnectionId;
+		StreamRing.PushSegment({ Format, false });
+	}
+
+	const int32 FrameBytes = Format.BitsPerSample / 8 * Format.NumChannels;
+	return StreamRing.PushSamples(Data, Size, FrameBytes) == Size;
+}
+
+void FOmniverseStreamVoice::EndStream(const FOmniverseWaveFormatInfo& Format)
+{
+	FOmniverseAudioSegment Segment;
+	Segment.Format = Format;
+	Segment.bStreamEnd = true;
+	StreamRing.PushSegment(Segment);
+}
+
+FOmniverseUnderrunStats FOmniverseStreamVoice::GetUnderrunStats() const
+{
+	FOmniverseUnderrunStats Stats;
+	Stats.NumUnderruns = NumUnderruns.load(std::memory_order_relaxed);
+	Stats.TotalSeconds = TotalUnderrunSeconds.load(std::memory_order_relaxed);
+	Stats.MaxSeconds = MaxUnderrunSeconds.load(std::memory_order_relaxed);
+	return Stats;
+}
+
+FOmniverseVoiceRender FOmniverseStreamVoice::Render(float* OutAudio, int32 InNumFrames, int32 InNumChannels, int32 InSampleRate, FOmniverseVoiceScratch& Scratch)
+{
+	FOmniverseVoiceRender Result;
+
+	const uint64 FlushPosition = InterruptPosition.exchange(MAX_uint64, std::memory_order_acquire);
+	if (FlushPosition != MAX_uint64)
+	{
+		Result.InterruptSilentFrame = Flush(FlushPosition, InNumChannels, InSampleRate);
+	}
+
+	// Silent, nothing queued nor fading out: the next buffer starts from silence
+	if (!bInUtterance && TailPosition >= TailFrames && !NextSegment.IsSet() && StreamRing.IsEmpty())
+	{
+		HistoryFrames = 0;
+		bWasPlaying = false;
+		return Result;
+	}
+
+	FMemory::Memzero(OutAudio, InNumFrames * InNumChannels * sizeof(float));
+	bStreamEnded = false;
+	ApplySegments();
+
+	if (MixFunction && ResampledMixFunction)
+	{
+		if (PlayingFormat.SamplesPerSecond != InSampleRate)
+		{
+			Result.RenderedFrames = RenderResampledStream(OutAudio, InNumFrames * InNumChannels, InNumChannels, InSampleRate, Scratch);
+		}
+		else
+		{
+			Result.RenderedFrames = RenderStream(OutAudio, InNumFrames * InNumChannels, InNumChannels, Scratch);
+		}
+	}
+
+	// Taken by the buffer which renders the stream
+	if (Result.RenderedFrames > 0)
+	{
+		Result.StreamStartFrame = StreamStartFrame;
+		StreamStartFrame = INDEX_NONE;
+	}
+
+	SmoothTransitions(OutAudio, Result.RenderedFrames, Result.StreamStartFrame, InNumFrames, InNumChannels, InSampleRate);
+	Result.bHasOutput = true;
+	return Result;
+}
+
+int32 FOmniverseStreamVoice::Flush(uint64 InPosition, int32 InNumChannels, int32 InSampleRate)
+{
+	// The streams queued after the interrupt are kept
+	StreamRing.Discard(InPosition);
+	NextSegment.Reset();
+	StreamStartFrame = INDEX_NONE;
+	bResetResampler = true;
+
+	// Mirrored from where the last buffer stopped, a concealment already fading out goes on
+	if (bWasPlaying && HistoryChannels == InNumChannels)
+	{
+		const int32 FadeFrames = FMath::Clamp(FMath::RoundToInt(InSampleRate * TRANSITION_FADE_SECONDS), 1, MAX_TAIL_FRAMES);
+		StartTail(HistoryBuffer.GetData(), 0, FadeFrames, InNumChannels);
+	}
+
+	bInUtterance = false;
+	bUnderrun = false;
+	bWasPlaying = false;
+	return FMath::Max(TailFrames - TailPosition, 0);
+}
+
+void FOmniverseStreamVoice::ApplySegments()
+{
+	if (NextSegment.IsSet())
+	{
+		ApplySegment(NextSegment.GetValue(), 0);
+		NextSegment.Reset();
+	}
+
+	FOmniverseAudioSegment Segment;
+	while (StreamRing.PopSegment(Segment))
+	{
+		ApplySegment(Segment, 0);
+	}
+}
+
+void FOmniverseStreamVoice::ApplySegment(const FOmniverseAudioSegment& InSegment, int32 InFrame)
+{
+	// Running dry after the end of the stream is no underrun
+	if (InSegment.bStreamEnd)
+	{
+		bInUtterance = false;
+		bUnderrun = false;
+		bStreamEnded = true;
+		return;
+	}
+
+	// The filter state doesn't carry over to another stream or format, the continuation of a connection keeps it
+	if (InSegment.bStreamStart || !(InSegment.Format == PlayingFormat))
+	{
+		bResetResampler = true;
+	}
+	if (InSegment.bStreamStart)
+	{
+		StreamStartFrame = InFrame;
+	}
+
+	PlayingFormat = InSegment.Format;
+	const bool bSupported = IsSupportedFormat(PlayingFormat);
+	MixFunction = bSupported ? GetOmniverseMixFunction(PlayingFormat) : nullptr;
+	ResampledMixFunction = bSupported ? GetOmniverseMixFunction({ PlayingFormat.SamplesPerSecond, PlayingFormat.NumChannels, 32, 3 }) : nullptr;
+}
+
+int32 FOmniverseStreamVoice::PopFrames(uint8* OutData, int32 InNumFrames)
+{
+	const int32 FrameBytes = PlayingFormat.BitsPerSample / 8 * PlayingFormat.NumChannels;
+	int32 PopSize = 0;
+	while (PopSize < InNumFrames * FrameBytes)
+	{
+		PopSize += StreamRing.PopSamples(OutData + PopSize, InNumFrames * FrameBytes - PopSize);
+
+		// The next stream of the same format fills the rest of the buffer, another format waits for the next one
+		FOmniverseAudioSegment Segment;
+		if (PopSize == InNumFrames * FrameBytes || !StreamRing.PopSegment(Segment))
+		{
+			break;
+		}
+		if (Segment.bStreamEnd || Segment.Format == PlayingFormat)
+		{
+			ApplySegment(Segment, PopSize / FrameBytes);
+		}
+		else
+		{
+			NextSegment = Segment;
+			break;
+		}
+	}
+
+	return PopSize / FrameBytes;
+}
+
+int32 FOmniverseStreamVoice::RenderStream(float* OutAudio, int32 InNumSamples, int32 InNumChannels, FOmniverseVoiceScratch& Scratch)
+{
+	const int32 StreamChannels = PlayingFormat.NumChannels;
+	const int32 FrameBytes = PlayingFormat.BitsPerSample / 8 * StreamChannels;
+
+	// The scratch is never grown here, what doesn't fit is played by the next buffer
+	const int32 NumFrames = FMath::Min(InNumSamples / InNumChannels, Scratch.PopBuffer.Num() / FrameBytes);
+	const int32 PoppedFrames = PopFrames(Scratch.PopBuffer.GetData(), NumFrames);
+	if (PoppedFrames > 0)
+	{
+		MixFunction(Scratch.PopBuffer.GetData(), PoppedFrames * StreamChannels, OutAudio, PoppedFrames * InNumChannels, InNumChannels);
+	}
+	return PoppedFrames;
+}
+
+int32 FOmniverseStreamVoice::RenderResampledStream(float* OutAudio, int32 InNumSamples, int32 InNumChannels, int32 InSampleRate, FOmniverseVoiceScratch& Scratch)
+{
+	const int32 StreamChannels = PlayingFormat.NumChannels;
+	const int32 FrameBytes = PlayingFormat.BitsPerSample / 8 * StreamChannels;
+
+	// The continuation of a connection keeps the filter state, a new stream or another rate restarts it
+	if (bResetResampler || !Resampler.IsResampling(PlayingFormat.SamplesPerSecond, InSampleRate, StreamChannels))
+	{
+		Resampler.Reset(PlayingFormat.SamplesPerSecond, InSampleRate, StreamChannels);
+		bResetResampler = false;
+	}
+
+	const int32 OutputFrames = FMath::Min(InNumSamples / InNumChannels, Scratch.ResampleBuffer.Num() / StreamChannels);
+	const int32 InputFrames = FMath::Min(Resampler.GetInputFramesNeeded(OutputFrames), Scratch.PopBuffer.Num() / FrameBytes);
+	const int32 FirstStreamStartFrame = StreamStartFrame;
+	if (InputFrames > 0)
+	{
+		// Stream samples to float at the stream channels, into the resampler input
+		const int32 PoppedFrames = PopFrames(Scratch.PopBuffer.GetData(), InputFrames);
+		if (PoppedFrames > 0)
+		{
+			MixFunction(Scratch.PopBuffer.GetData(), PoppedFrames * StreamChannels, Resampler.GetInputBuffer(PoppedFrames), PoppedFrames * StreamChannels, StreamChannels);
+			Resampler.CommitInput(PoppedFrames);
+		}
+	}
+
+	// A stream starting inside the input is at the device frame of the same time
+	if (StreamStartFrame != FirstStreamStartFrame && StreamStartFrame != INDEX_NONE)
+	{
+		StreamStartFrame = (int32)((int64)StreamStartFrame * InSampleRate / PlayingFormat.SamplesPerSecond);
+	}
+
+	const int32 RenderedFrames = Resampler.Process(Scratch.ResampleBuffer.GetData(), OutputFrames);
+	ResampledMixFunction((const uint8*)Scratch.ResampleBuffer.GetData(), RenderedFrames * StreamChannels, OutAudio, RenderedFrames * InNumChannels, InNumChannels);
+	return RenderedFrames;
+}
+
+void FOmniverseStreamVoice::SmoothTransitions(float* OutAudio, int32 InRenderedFrames, int32 InBoundaryFrame, int32 InNumFrames, int32 InNumChannels, int32 InSampleRate)
+{
+	// Another device layout, the history doesn't match
+	if (HistoryChannels != InNumChannels)
+	{
+		HistoryChannels = InNumChannels;
+		HistoryFrames = 0;
+		TailFrames = 0;
+	}
+
+	const int32 FadeFrames = FMath::Clamp(FMath::RoundToInt(InSampleRate * TRANSITION_FADE_SECONDS), 1, MAX_TAIL_FRAMES);
+	const int32 ConcealFrames = GOmniverseAudioConcealment.load(std::memory_order_relaxed)
+		? FMath::Clamp(FMath::RoundToInt(InSampleRate * CONCEALMENT_SECONDS), 1, MAX_TAIL_FRAMES)
+		: FadeFrames;
+
+	int32 TailStartFrame = 0;
+	if (InRenderedFrames > 0)
+	{
+		// Data again after the stream ran dry, crossfaded with the concealment still fading out
+		if (!bWasPlaying)
+		{
+			FadeIn(OutAudio, 0, FMath::Min(FadeFrames, InRenderedFrames), InNumChannels);
+		}
+		bUnderrun = false;
+
+		// The previous stream fades out over the start of the next one
+		if (InBoundaryFrame != INDEX_NONE && (InBoundaryFrame > 0 || bWasPlaying))
+		{
+			MixTail(OutAudio, 0, InBoundaryFrame, InNumChannels);
+			StartTail(OutAudio, InBoundaryFrame, FadeFrames, InNumChannels);
+			TailStartFrame = InBoundaryFrame;
+			FadeIn(OutAudio, InBoundaryFrame, FMath::Min(FadeFrames, InRenderedFrames - InBoundaryFrame), InNumChannels);
+		}
+
+		if (!bStreamEnded)
+		{
+			bInUtterance = true;
+		}
+	}
+
+	// Ran dry inside an utterance: the last audio is concealed, or faded out
+	if (bInUtterance && InRenderedFrames < InNumFrames)
+	{
+		if (InRenderedFrames > 0 || bWasPlaying)
+		{
+			MixTail(OutAudio, TailStartFrame, InRenderedFrames, InNumChannels);
+			StartTail(OutAudio, InRenderedFrames, ConcealFrames, InNumChannels);
+			TailStartFrame = InRenderedFrames;
+		}
+		RecordUnderrun(InNumFrames - InRenderedFrames, InSampleRate);
+	}
+
+	MixTail(OutAudio, TailStartFrame, InNumFrames, InNumChannels);
+	UpdateHistory(OutAudio, InNumFrames, InNumChannels);
+	bWasPlaying = InRenderedFrames == InNumFrames;
+}
+
+void FOmniverseStreamVoice::StartTail(const float* InAudio, int32 InFrame, int32 InTailFrames, int32 InNumChannels)
+{
+	// Mirrored around InFrame, so the tail starts where the audio stopped
+	TailFrames = FMath::Min(InTailFrames, InFrame + HistoryFrames);
+	TailPosition = 0;
+	for (int32 TailFrame = 0; TailFrame < TailFrames; ++TailFrame)
+	{
+		const int32 SourceFrame = InFrame - 1 - TailFrame;
+		const float* Source = SourceFrame >= 0
+			? InAudio + SourceFrame * InNumChannels
+			: HistoryBuffer.GetData() + (HistoryFrames + SourceFrame) * InNumChannels;
+		FMemory::Memcpy(TailBuffer.GetData() + TailFrame * InNumChannels, Source, InNumChannels * sizeof(float));
+	}
+}
+
+void FOmniverseStreamVoice::MixTail(float* OutAudio, int32 InStartFrame, int32 InEndFrame, int32 InNumChannels)
+{
+	for (int32 Frame = InStartFrame; Frame < InEndFrame && TailPosition < TailFrames; ++Frame, ++TailPosition)
+	{
+		const float TailGain = (float)(TailFrames - TailPosition) / (TailFrames + 1);
+		const float* Source = TailBuffer.GetData() + TailPosition * InNumChannels;
+		float* Output = OutAudio + Frame * InNumChannels;
+		for (int32 Channel = 0; Channel < InNumChannels; ++Channel)
+		{
+			Output[Channel] += Source[Channel] * TailGain;
+		}
+	}
+}
+
+void FOmniverseStreamVoice::FadeIn(float* OutAudio, int32 InFrame, int32 InFadeFrames, int32 InNumChannels)
+{
+	for (int32 Frame = 0; Frame < InFadeFrames; ++Frame)
+	{
+		const float FadeGain = (float)(Frame + 1) / (InFadeFrames + 1);
+		float* Output = OutAudio + (InFrame + Frame) * InNumChannels;
+		for (int32 Channel = 0; Channel < InNumChannels; ++Channel)
+		{
+			Output[Channel] *= FadeGain;
+		}
+	}
+}
+
+void FOmniverseStreamVoice::UpdateHistory(const float* InAudio, int32 InNumFrames, int32 InNumChannels)
+{
+	// The last frames of the output, older ones first
+	const int32 NewFrames = FMath::Min(InNumFrames, MAX_TAIL_FRAMES);
+	const int32 KeptFrames = FMath::Min(HistoryFrames, MAX_TAIL_FRAMES - NewFrames);
+	if (KeptFrames > 0)
+	{
+		FMemory::Memmove(HistoryBuffer.GetData(), HistoryBuffer.GetData() + (HistoryFrames - KeptFrames) * InNumChannels, KeptFrames * InNumChannels * sizeof(float));
+	}
+	FMemory::Memcpy(HistoryBuffer.GetData() + KeptFrames * InNumChannels, InAudio + (InNumFrames - NewFrames) * InNumChannels, NewFrames * InNumChannels * sizeof(float));
+	HistoryFrames = KeptFrames + NewFrames;
+}
+
+void FOmniverseStreamVoice::RecordUnderrun(int32 InMissingFrames, int32 InSampleRate)
+{
+	if (!bUnderrun)
+	{
+		bUnderrun = true;
+		UnderrunSeconds = 0.0;
+		NumUnderruns.store(NumUnderruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	const double MissingSeconds = InSampleRate > 0 ? InMissingFrames / (double)InSampleRate : 0.0;
+	UnderrunSeconds += MissingSeconds;
+	TotalUnderrunSeconds.store(TotalUnderrunSeconds.load(std::memory_order_relaxed) + MissingSeconds, std::memory_order_relaxed);
+	if (UnderrunSeconds > MaxUnderrunSeconds.load(std::memory_order_relaxed))
+	{
+		MaxUnderrunSeconds.store(UnderrunSeconds, std::memory_order_relaxed);
+	}
+
+	if (UnderrunSeconds >= MAX_UNDERRUN_SECONDS)
+	{
+		bInUtterance = false;
+		bUnderrun = false;
+	}
+}
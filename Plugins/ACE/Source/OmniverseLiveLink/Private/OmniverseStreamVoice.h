@@ -0,0 +1,146 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "OmniverseWaveDef.h"
+#include "OmniverseAudioRing.h"
+#include "OmniverseSampleMixer.h"
+#include "OmniverseStreamResampler.h"
+#include <atomic>
+
+// Underruns of a stream, the ring running dry inside an utterance
+struct FOmniverseUnderrunStats
+{
+	int32 NumUnderruns = 0;
+	double TotalSeconds = 0.0;
+	double MaxSeconds = 0.0;
+};
+
+// Scratch of the audio render thread, shared by the voices of a listener as they're rendered one after another
+struct FOmniverseVoiceScratch
+{
+	TArray<uint8> PopBuffer;
+	TArray<float> ResampleBuffer;
+};
+
+// A device buffer rendered by a voice
+struct FOmniverseVoiceRender
+{
+	// Stream frames in the buffer, and the frame a new stream started at
+	int32 RenderedFrames = 0;
+	int32 StreamStartFrame = INDEX_NONE;
+	// Anything to mix, the stream or a tail fading out
+	bool bHasOutput = false;
+	// The voice was flushed by an interrupt, the frame its audio faded out by
+	int32 InterruptSilentFrame = INDEX_NONE;
+};
+
+// Plays the streams queued to it one after another, in its own ring, format, resampler and transitions.
+// The voices of a listener play at the same time, each one mixed to the device buffer with its gain
+class FOmniverseStreamVoice
+{
+public:
+	FOmniverseStreamVoice(int32 InRingCapacity);
+
+	// Render state of device buffers up to InMaxBufferFrames, nothing is allocated when rendering
+	void Activate(int32 InMaxBufferFrames);
+
+	// Producer thread: a header starts a new stream in its format, the samples of a connection are appended in the format of its last header
+	void BeginStream(const FOmniverseWaveFormatInfo& Format, uint32 ConnectionId);
+	// False if samples were dropped, the ring is full
+	bool AppendStream(const uint8* Data, int32 Size, const FOmniverseWaveFormatInfo& Format, uint32 ConnectionId);
+	// The stream of the connection ended, running dry after it is no underrun
+	void EndStream(const FOmniverseWaveFormatInfo& Format);
+	// All of the queued samples were played
+	bool IsDrained() const { return StreamRing.GetStats().FillBytes == 0; }
+	// Any thread: the samples queued so far are dropped by the next buffer, which fades out the audio playing
+	void Interrupt() { InterruptPosition.store(StreamRing.GetWritePosition(), std::memory_order_release); }
+
+	// Audio render thread: the stream into OutAudio, zeroed at the device layout
+	FOmniverseVoiceRender Render(float* OutAudio, int32 InNumFrames, int32 InNumChannels, int32 InSampleRate, FOmniverseVoiceScratch& Scratch);
+
+	void SetGain(float InGain) { Gain.store(InGain, std::memory_order_relaxed); }
+	float GetGain() const { return Gain.load(std::memory_order_relaxed); }
+
+	FOmniverseAudioRingStats GetRingStats() const { return StreamRing.GetStats(); }
+	FOmniverseUnderrunStats GetUnderrunStats() const;
+
+#if WITH_DEV_AUTOMATION_TESTS
+	// Allocations of the buffers rendered by the voice, see FOmniverseRenderCheck
+	uint32 HashRenderBuffers(uint32 InHash) const
+	{
+		InHash = FOmniverseRenderCheck::HashBuffer(HistoryBuffer, InHash);
+		InHash = FOmniverseRenderCheck::HashBuffer(TailBuffer, InHash);
+		return Resampler.HashBuffers(StreamRing.HashBuffers(InHash));
+	}
+#endif
+
+private:
+	// Drops the ring up to InPosition and the stream state, the audio played last fades out. Returns the faded frames
+	int32 Flush(uint64 InPosition, int32 InNumChannels, int32 InSampleRate);
+	// The markers at the head of the ring, and the one a buffer stopped at
+	void ApplySegments();
+	void ApplySegment(const FOmniverseAudioSegment& InSegment, int32 InFrame);
+	// Up to InNumFrames stream frames, across the markers of the same format
+	int32 PopFrames(uint8* OutData, int32 InNumFrames);
+	// Mix the stream to the device buffer, returns the device frames rendered
+	int32 RenderStream(float* OutAudio, int32 InNumSamples, int32 InNumChannels, FOmniverseVoiceScratch& Scratch);
+	int32 RenderResampledStream(float* OutAudio, int32 InNumSamples, int32 InNumChannels, int32 InSampleRate, FOmniverseVoiceScratch& Scratch);
+	// Fades of the rendered frames: the audio before an underrun or a stream boundary fades out in a mirrored tail,
+	// the audio after a recovery or a boundary fades in, so the two crossfade
+	void SmoothTransitions(float* OutAudio, int32 InRenderedFrames, int32 InBoundaryFrame, int32 InNumFrames, int32 InNumChannels, int32 InSampleRate);
+	void StartTail(const float* InAudio, int32 InFrame, int32 InTailFrames, int32 InNumChannels);
+	void MixTail(float* OutAudio, int32 InStartFrame, int32 InEndFrame, int32 InNumChannels);
+	void FadeIn(float* OutAudio, int32 InFrame, int32 InFadeFrames, int32 InNumChannels);
+	void UpdateHistory(const float* InAudio, int32 InNumFrames, int32 InNumChannels);
+	void RecordUnderrun(int32 InMissingFrames, int32 InSampleRate);
+
+	// Fixed capacity, sized when the voice is created
+	FOmniverseAudioRing StreamRing;
+
+	// Producer thread: the connection the ring was last appended for
+	uint32 AppendingConnectionId = 0;
+
+	// Audio render thread: format of the samples at the head of the ring
+	FOmniverseWaveFormatInfo PlayingFormat = {};
+	FOmniverseMixFunction MixFunction = nullptr;
+	// Kernel of the resampled float frames, same channels as the stream
+	FOmniverseMixFunction ResampledMixFunction = nullptr;
+	// Marker of another format a buffer stopped at, applied by the next one
+	TOptional<FOmniverseAudioSegment> NextSegment;
+	// Frame of the buffer being rendered where a new stream started, until a buffer renders it
+	int32 StreamStartFrame = INDEX_NONE;
+	// Streams at another rate than the device, the filter state is kept across the buffers of a stream
+	FOmniverseStreamResampler Resampler;
+	bool bResetResampler = true;
+
+	// The last frames of the previous buffers are kept for the tails
+	TArray<float> HistoryBuffer;
+	int32 HistoryFrames = 0;
+	int32 HistoryChannels = 0;
+	// Mirrored frames before an underrun or a boundary, fading out
+	TArray<float> TailBuffer;
+	int32 TailFrames = 0;
+	int32 TailPosition = 0;
+	// The last buffer rendered to its end, a stream is playing and not ended, the end marker was reached in this buffer
+	bool bWasPlaying = false;
+	bool bInUtterance = false;
+	bool bStreamEnded = false;
+	bool bUnderrun = false;
+	double UnderrunSeconds = 0.0;
+
+	std::atomic<float> Gain = 1.0f;
+	// Write position of the ring at the last interrupt, MAX_uint64 once it's flushed
+	std::atomic<uint64> InterruptPosition = MAX_uint64;
+
+	// Written by the audio render thread only
+	std::atomic<int32> NumUnderruns = 0;
+	std::atomic<double> TotalUnderrunSeconds = 0.0;
+	std::atomic<double> MaxUnderrunSeconds = 0.0;
+};
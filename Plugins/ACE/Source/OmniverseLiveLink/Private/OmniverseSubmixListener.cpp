@@ -9,24 +9,58 @@
 #include "OmniverseSubmixListener.h"
 #include "AudioMixerDevice.h"
 #include "AudioMixerSubmix.h"
+#include "Engine/Engine.h"
 #include "Engine/World.h"
 #include "Runtime/Launch/Resources/Version.h"
 
 #include "ACEPrivate.h"
 #include "OmniverseAudioMixer.h"
+#include "OmniverseSampleMixer.h"
 
 #define LOCTEXT_NAMESPACE "OmniverseSubmixListener"
 
+// The playback position is stale when no buffer was rendered for this long
+#define PLAYBACK_CLOCK_TIMEOUT_SECONDS 0.1
+// Frames of a device buffer if the device doesn't tell
+#define DEFAULT_BUFFER_FRAMES 1024
+// Bytes of the widest stream sample, 64-bit float
+#define MAX_SAMPLE_BYTES 8
+// Stream channels of the resampled frames, mono or stereo
+#define MAX_STREAM_CHANNELS 2
+// Overflows of the stream ring are logged at most this often
+#define OVERFLOW_LOG_INTERVAL_SECONDS 5.0
+// Voices of a source at most
+#define MAX_AUDIO_VOICES 16
+
 
 static TAutoConsoleVariable<int32> CVarOmniverseWaveStreamBufferSize(
 	TEXT("omni.WaveStreamBufferSize"),
 	1,
-	TEXT("Adjusts the size of the circular audio sample buffer in MB (default is 1).\n"),
+	TEXT("Adjusts the size of the circular audio sample buffer of each voice in MB (default is 1). The newest samples are dropped when it's full.\n"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarOmniverseMaxAudioVoices(
+	TEXT("omni.MaxAudioVoices"),
+	4,
+	TEXT("Streams of different connections a source plays at the same time, up to 16 (default is 4). Read when the source is created.\n"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarOmniverseForceDeviceSampleRate(
+	TEXT("omni.ForceDeviceSampleRate"),
+	0,
+	TEXT("1 creates an own audio device at the sample rate of each source, instead of playing the streams resampled on the main audio device (default is 0).\n"),
 	ECVF_Default);
 
 
 FOmniverseSubmixListener::FOmniverseSubmixListener()
 {
+	const int32 RingCapacity = FMath::Clamp(CVarOmniverseWaveStreamBufferSize.GetValueOnAnyThread(), 1, 1024) * 1024 * 1024;
+	const int32 NumVoices = FMath::Clamp(CVarOmniverseMaxAudioVoices.GetValueOnAnyThread(), 1, MAX_AUDIO_VOICES);
+	for (int32 VoiceIndex = 0; VoiceIndex < NumVoices; ++VoiceIndex)
+	{
+		Voices.Add(MakeUnique<FOmniverseStreamVoice>(RingCapacity));
+	}
+	VoiceOwners.SetNum(NumVoices);
 	DeviceDestroyedHandle = FAudioDeviceManagerDelegates::OnAudioDeviceDestroyed.AddRaw(this, &FOmniverseSubmixListener::OnDeviceDestroyed);
 }
 
@@ -38,7 +72,8 @@ FOmniverseSubmixListener::~FOmniverseSubmixListener()
 // Register with audio device my submix listener
 void FOmniverseSubmixListener::Activate()
 {
-	if (FAudioDeviceManager* AudioDeviceManager = FAudioDeviceManager::Get())
+	FAudioDeviceManager* AudioDeviceManager = FAudioDeviceManager::Get();
+	if (AudioDeviceManager && CVarOmniverseForceDeviceSampleRate.GetValueOnAnyThread() != 0)
 	{
 		FOmniverseAudioMixerModule* AudioModule = &FModuleManager::GetModuleChecked<FOmniverseAudioMixerModule>("OmniverseAudioMixer");
 		if (AudioModule)
@@ -54,35 +89,67 @@ void FOmniverseSubmixListener::Activate()
 			MainDeviceParams.AssociatedWorld = GWorld;
 			MainDeviceParams.AudioModule = AudioModule;
 			AudioDeviceHandle = AudioDeviceManager->RequestAudioDevice(MainDeviceParams);
+			bOwnsAudioDevice = true;
 
 			// Device is created, start audio thread
 			FAudioThread::StartAudioThread();
+		}
+	}
+	else if (GEngine)
+	{
+		// Mixed with the rest of the game, no extra device or render thread
+		AudioDeviceHandle = GEngine->GetMainAudioDevice();
+		bOwnsAudioDevice = false;
+	}
 
-			if (AudioDeviceHandle.IsValid())
-			{
-				FAudioDevice* AudioDevice = AudioDeviceHandle.GetAudioDevice();
+	if (AudioDeviceHandle.IsValid())
+	{
+		FAudioDevice* AudioDevice = AudioDeviceHandle.GetAudioDevice();
 #if ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION >= 3
-				if (AudioDevice)
+		if (AudioDevice)
 #else
-				if (AudioDevice && AudioDevice->IsAudioMixerEnabled())
+		if (AudioDevice && AudioDevice->IsAudioMixerEnabled())
 #endif
+		{
+			Audio::FMixerDevice* MixerDevice = static_cast<Audio::FMixerDevice*>(AudioDevice);
+			if (MixerDevice)
+			{
+				auto MixerSubmixPtr = MixerDevice->GetMasterSubmix().Pin();
+				if (MixerSubmixPtr.IsValid())
 				{
-					Audio::FMixerDevice* MixerDevice = static_cast<Audio::FMixerDevice*>(AudioDevice);
-					if (MixerDevice)
-					{
-						auto MixerSubmixPtr = MixerDevice->GetMasterSubmix().Pin();
-						if (MixerSubmixPtr.IsValid())
+					MixerDevice->AudioRenderThreadCommand([MixerSubmixPtr]()
 						{
-							MixerDevice->AudioRenderThreadCommand([MixerSubmixPtr]()
-								{
-									MixerSubmixPtr->SetAutoDisable(false);
-								});
-						}
-					}
+							MixerSubmixPtr->SetAutoDisable(false);
+						});
 				}
-				AudioDeviceHandle->RegisterSubmixBufferListener(this);
 			}
 		}
+
+		// A generator on the main device renders the streams of an own device too
+		int32 BufferFrames = FMath::Max(AudioDeviceHandle->GetBufferLength(), DEFAULT_BUFFER_FRAMES);
+		if (GEngine && GEngine->GetMainAudioDeviceRaw())
+		{
+			BufferFrames = FMath::Max(BufferFrames, GEngine->GetMainAudioDeviceRaw()->GetBufferLength());
+		}
+		ActivateRender(BufferFrames);
+
+		AudioDeviceHandle->RegisterSubmixBufferListener(this);
+	}
+
+	bSubmixActivated = true;
+}
+
+void FOmniverseSubmixListener::ActivateRender(int32 InMaxBufferFrames)
+{
+	// Any stream format and device layout fits, the render thread never grows them
+	MaxBufferFrames = InMaxBufferFrames;
+	MaxBufferSamples = InMaxBufferFrames * AUDIO_MIXER_MAX_OUTPUT_CHANNELS;
+	Scratch.PopBuffer.SetNumUninitialized(MaxBufferSamples * MAX_SAMPLE_BYTES);
+	Scratch.ResampleBuffer.SetNumUninitialized(InMaxBufferFrames * MAX_STREAM_CHANNELS);
+	VoiceBuffer.SetNumZeroed(MaxBufferSamples);
+	for (const TUniquePtr<FOmniverseStreamVoice>& Voice : Voices)
+	{
+		Voice->Activate(InMaxBufferFrames);
 	}
 
 	bSubmixActivated = true;
@@ -92,338 +159,308 @@ void FOmniverseSubmixListener::Deactivate()
 {
 	bSubmixActivated = false;
 
-	if (FAudioDeviceManager* AudioDeviceManager = FAudioDeviceManager::Get())
+	if (AudioDeviceHandle.IsValid())
 	{
-		if (AudioDeviceHandle.IsValid())
-		{
-			AudioDeviceHandle->UnregisterSubmixBufferListener(this);
-
-			// AudioDeviceHandle needs to be released without Audio thread
-			FAudioThread::StopAudioThread();
-			AudioDeviceHandle.Reset();
-			FAudioThread::StartAudioThread();
-		}
+		AudioDeviceHandle->UnregisterSubmixBufferListener(this);
+		ReleaseAudioDevice();
 	}
 }
 
-void FOmniverseSubmixListener::OnDeviceDestroyed(Audio::FDeviceId InDeviceId)
+void FOmniverseSubmixListener::ReleaseAudioDevice()
 {
-	if (AudioDeviceHandle.IsValid() && InDeviceId == AudioDeviceHandle.GetDeviceID())
+	if (bOwnsAudioDevice)
 	{
 		// AudioDeviceHandle needs to be released without Audio thread
 		FAudioThread::StopAudioThread();
 		AudioDeviceHandle.Reset();
 		FAudioThread::StartAudioThread();
+	}
+	else
+	{
+		AudioDeviceHandle.Reset();
+	}
+	bOwnsAudioDevice = false;
+}
+
+void FOmniverseSubmixListener::OnDeviceDestroyed(Audio::FDeviceId InDeviceId)
+{
+	if (AudioDeviceHandle.IsValid() && InDeviceId == AudioDeviceHandle.GetDeviceID())
+	{
+		ReleaseAudioDevice();
 
 		FAudioDeviceManagerDelegates::OnAudioDeviceDestroyed.Remove(DeviceDestroyedHandle);
 	}
 }
 
-void FOmniverseSubmixListener::AddNewWave(const FOmniverseWaveFormatInfo& Format)
+bool FOmniverseSubmixListener::AttachGenerator(const void* InGenerator)
+{
+	const void* NoGenerator = nullptr;
+	return AttachedGenerator.compare_exchange_strong(NoGenerator, InGenerator);
+}
+
+void FOmniverseSubmixListener::DetachGenerator(const void* InGenerator)
+{
+	const void* Generator = InGenerator;
+	AttachedGenerator.compare_exchange_strong(Generator, nullptr);
+}
+
+FOmniverseStreamVoice* FOmniverseSubmixListener::AssignVoice(uint32 ConnectionId)
 {
-	int32 BufferMB = CVarOmniverseWaveStreamBufferSize.GetValueOnAnyThread();
-	auto NewStream = MakeShareable(new FWaveStream(Format, BufferMB * 1024 * 1024));
-	
-	if (!PlayingStream.IsValid())
+	// The streams of a connection play one after another on its voice
+	if (const int32* VoiceIndex = ConnectionVoices.Find(ConnectionId))
 	{
-		PlayingStream = NewStream;
+		return Voices[*VoiceIndex].Get();
 	}
 
-	if (!LastPlayingStream.IsValid())
+	// A voice nobody plays on or which played its ended stream through, else the ended one with the least queued,
+	// else the least queued: the stream waits for the one before it
+	int32 BestIndex = INDEX_NONE;
+	int64 BestFill = 0;
+	bool bBestEnded = false;
+	for (int32 VoiceIndex = 0; VoiceIndex < Voices.Num(); ++VoiceIndex)
 	{
-		LastPlayingStream = PlayingStream;
+		const FVoiceOwner& Owner = VoiceOwners[VoiceIndex];
+		const int64 Fill = Voices[VoiceIndex]->GetRingStats().FillBytes;
+		if (Owner.ConnectionId == 0 || (Owner.bEnded && Voices[VoiceIndex]->IsDrained()))
+		{
+			BestIndex = VoiceIndex;
+			break;
+		}
+		if (BestIndex == INDEX_NONE || (Owner.bEnded && !bBestEnded) || (Owner.bEnded == bBestEnded && Fill < BestFill))
+		{
+			BestIndex = VoiceIndex;
+			BestFill = Fill;
+			bBestEnded = Owner.bEnded;
+		}
 	}
-	else
+
+	FVoiceOwner& Owner = VoiceOwners[BestIndex];
+	if (Owner.ConnectionId != 0)
 	{
-		LastPlayingStream.Pin()->NextStream = NewStream;
-		LastPlayingStream = LastPlayingStream.Pin()->NextStream;
+		UE_LOG(LogACE, Verbose, TEXT("Audio voice %d moves from connection %u to %u."), BestIndex, Owner.ConnectionId, ConnectionId);
+		ConnectionVoices.Remove(Owner.ConnectionId);
 	}
+	Owner.ConnectionId = ConnectionId;
+	Owner.bEnded = false;
+	ConnectionVoices.Add(ConnectionId, BestIndex);
+	return Voices[BestIndex].Get();
 }
 
-void FOmniverseSubmixListener::AppendStream(const uint8* Data, int32 Size)
+void FOmniverseSubmixListener::BeginStream(const FOmniverseWaveFormatInfo& Format, uint32 ConnectionId)
 {
-	auto LastStream = LastPlayingStream;
+	ConnectionFormats.Add(ConnectionId, Format);
+	FOmniverseStreamVoice* Voice = AssignVoice(ConnectionId);
+	VoiceOwners[ConnectionVoices[ConnectionId]].bEnded = false;
+	Voice->BeginStream(Format, ConnectionId);
+}
 
-	if (LastStream.IsValid())
+void FOmniverseSubmixListener::AppendStream(const uint8* Data, int32 Size, uint32 ConnectionId)
+{
+	const FOmniverseWaveFormatInfo* Format = ConnectionFormats.Find(ConnectionId);
+	const int32* VoiceIndex = ConnectionVoices.Find(ConnectionId);
+	// No header yet, or its voice was taken over
+	if (Format == nullptr || VoiceIndex == nullptr)
 	{
-		FOmniverseWaveFormatInfo& WaveFormat = LastStream.Pin()->WaveFormat;
-		if ((WaveFormat.SampleType == 1 || WaveFormat.SampleType == 3) 
-		&& (WaveFormat.NumChannels == 1 || WaveFormat.NumChannels == 2))
+		return;
+	}
+
+	FOmniverseStreamVoice& Voice = *Voices[*VoiceIndex];
+	if (!Voice.AppendStream(Data, Size, *Format, ConnectionId))
+	{
+		const double CurrentTime = FPlatformTime::Seconds();
+		if (CurrentTime - LastOverflowLogTime > OVERFLOW_LOG_INTERVAL_SECONDS)
 		{
-			// Always append to the last stream
-			int32 PushSize = LastStream.Pin()->LocklessStreamBuffer.Push(Data, Size);
-			if (PushSize != Size)
-			{
-				// Alloc new buffer
-				AddNewWave(WaveFormat);
-				AppendStream(Data + PushSize, Size - PushSize);
-			}
+			LastOverflowLogTime = CurrentTime;
+			const FOmniverseAudioRingStats Stats = Voice.GetRingStats();
+			UE_LOG(LogACE, Warning, TEXT("Audio stream buffer is full, %lld bytes dropped in %lld overflows. Increase omni.WaveStreamBufferSize (%lld bytes)."),
+				Stats.DroppedBytes, Stats.NumOverflows, Stats.Capacity);
 		}
 	}
+}
 
-	TrySwitchToNextStream();
+void FOmniverseSubmixListener::EndStream(uint32 ConnectionId)
+{
+	const FOmniverseWaveFormatInfo* Format = ConnectionFormats.Find(ConnectionId);
+	const int32* VoiceIndex = ConnectionVoices.Find(ConnectionId);
+	if (Format && VoiceIndex)
+	{
+		Voices[*VoiceIndex]->EndStream(*Format);
+		VoiceOwners[*VoiceIndex].bEnded = true;
+	}
 }
 
-void FOmniverseSubmixListener::TrySwitchToNextStream()
+void FOmniverseSubmixListener::Interrupt()
 {
-	// Clean the stream buffer if it's empty
-	auto CurrentStream = PlayingStream;
-	if (CurrentStream.IsValid() && CurrentStream->NextStream != nullptr && !CurrentStream->HasStream())
+	InterruptTime.store(FPlatformTime::Seconds(), std::memory_order_relaxed);
+	for (const TUniquePtr<FOmniverseStreamVoice>& Voice : Voices)
 	{
-		UE_LOG(LogACE, Log, TEXT("Clean the stream buffer."));
-		auto Temp = CurrentStream->NextStream;
-		CurrentStream->NextStream = nullptr;
-		PlayingStream = Temp;
+		Voice->Interrupt();
 	}
 }
 
-// ISubmixBufferListener
-// when called, submit samples to audio device in OnNewSubmixBuffer
-void FOmniverseSubmixListener::OnNewSubmixBuffer(const USoundSubmix* OwningSubmix, float* AudioData, int32 NumSamples, int32 NumChannels, const int32 SampleRate, double AudioClock)
+int32 FOmniverseSubmixListener::GetInterruptStats(double& OutLastLatency, double& OutMaxLatency) const
 {
-	auto GetFloatSample = [](uint8* Buffer, int32 StartIndex, int32 BufferSize, int32 BitsPerSample, int32 SampleType, float& Out)
+	OutLastLatency = LastInterruptLatency.load(std::memory_order_relaxed);
+	OutMaxLatency = MaxInterruptLatency.load(std::memory_order_relaxed);
+	return NumInterrupts.load(std::memory_order_relaxed);
+}
+
+void FOmniverseSubmixListener::RecordInterrupt(int32 InSilentFrame, int32 InSampleRate)
+{
+	const double RequestTime = InterruptTime.exchange(0.0, std::memory_order_relaxed);
+	if (RequestTime <= 0.0 || InSampleRate <= 0)
 	{
-		if (BitsPerSample == 32 && SampleType == 3)
-		{
-			if (StartIndex + 3 >= BufferSize)
-			{
-				return false;
-			}
-			// IEEE Float
-			float* Sample = reinterpret_cast<float*>(Buffer);
-			Out = (*Sample);
-			return true;
-		}
-		else if (BitsPerSample == 64 && SampleType == 3)
-		{
-			if (StartIndex + 7 >= BufferSize)
-			{
-				return false;
-			}
+		return;
+	}
 
-			// IEEE Float
-			double* Sample = reinterpret_cast<double*>(Buffer);
-			Out = (float)(*Sample);
-			return true;
-		}
-		else if (BitsPerSample == 16 && SampleType == 1)
-		{
-			if (StartIndex + 1 >= BufferSize)
-			{
-				return false;
-			}
+	// The buffer is played as it's rendered, silent from the end of the fade out
+	const double Latency = FPlatformTime::Seconds() - RequestTime + InSilentFrame / (double)InSampleRate;
+	LastInterruptLatency.store(Latency, std::memory_order_relaxed);
+	if (Latency > MaxInterruptLatency.load(std::memory_order_relaxed))
+	{
+		MaxInterruptLatency.store(Latency, std::memory_order_relaxed);
+	}
+	NumInterrupts.store(NumInterrupts.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
 
-			// convert 16bit pcm to float
-			int16* Sample = reinterpret_cast<int16*>(Buffer);
-			Out = (float)(*Sample) / ((*Sample) >= 0 ? (float)MAX_int16 : ((float)MAX_int16 + 1));
-			return true;
-		}
-		else if (BitsPerSample == 8 && SampleType == 1)
-		{
-			if (StartIndex >= BufferSize)
-			{
-				return false;
-			}
+FOmniverseAudioRingStats FOmniverseSubmixListener::GetRingStats() const
+{
+	FOmniverseAudioRingStats Stats;
+	for (const TUniquePtr<FOmniverseStreamVoice>& Voice : Voices)
+	{
+		const FOmniverseAudioRingStats VoiceStats = Voice->GetRingStats();
+		Stats.Capacity += VoiceStats.Capacity;
+		Stats.FillBytes += VoiceStats.FillBytes;
+		Stats.PeakFillBytes = FMath::Max(Stats.PeakFillBytes, VoiceStats.PeakFillBytes);
+		Stats.DroppedBytes += VoiceStats.DroppedBytes;
+		Stats.NumOverflows += VoiceStats.NumOverflows;
+	}
+	return Stats;
+}
 
-			// convert 8bit pcm to float
-			int8* Sample = reinterpret_cast<int8*>(Buffer);
-			Out = (float)(*Sample) / ((*Sample) >= 0 ? (float)MAX_int8 : ((float)MAX_int8 + 1));
-			return true;
-		}
+FOmniverseUnderrunStats FOmniverseSubmixListener::GetUnderrunStats() const
+{
+	FOmniverseUnderrunStats Stats;
+	for (const TUniquePtr<FOmniverseStreamVoice>& Voice : Voices)
+	{
+		const FOmniverseUnderrunStats VoiceStats = Voice->GetUnderrunStats();
+		Stats.NumUnderruns += VoiceStats.NumUnderruns;
+		Stats.TotalSeconds += VoiceStats.TotalSeconds;
+		Stats.MaxSeconds = FMath::Max(Stats.MaxSeconds, VoiceStats.MaxSeconds);
+	}
+	return Stats;
+}
+
+void FOmniverseSubmixListener::SetVoiceGain(int32 InVoiceIndex, float InGain)
+{
+	if (Voices.IsValidIndex(InVoiceIndex))
+	{
+		Voices[InVoiceIndex]->SetGain(InGain);
+	}
+}
+
+bool FOmniverseSubmixListener::GetPlaybackPosition(double& OutPosition, double& OutStreamStartTime) const
+{
+	FPlaybackClock Clock;
+	uint32 Sequence = 0;
+	do
+	{
+		Sequence = PlaybackClockSequence.load(std::memory_order_acquire);
+		Clock = PlaybackClock;
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while ((Sequence & 1) != 0 || PlaybackClockSequence.load(std::memory_order_relaxed) != Sequence);
 
+	const double ElapsedTime = FPlatformTime::Seconds() - Clock.BufferTime;
+	if (!Clock.bStarted || Clock.BufferDuration <= 0.0 || ElapsedTime > PLAYBACK_CLOCK_TIMEOUT_SECONDS)
+	{
 		return false;
-	};
+	}
 
-	auto CurrentStream = PlayingStream;
-	if (bSubmixActivated && CurrentStream.IsValid())
+	// The last buffer is being played since it was rendered, a stream starting inside it is at 0 before its first frame
+	OutPosition = FMath::Max(Clock.Position + FMath::Clamp(ElapsedTime, 0.0, Clock.BufferDuration), 0.0);
+	OutStreamStartTime = Clock.StreamStartTime;
+	return true;
+}
+
+void FOmniverseSubmixListener::UpdatePlaybackClock(int32 InStreamStartFrame, int32 InRenderedFrames, int32 InNumFrames, int32 InSampleRate)
+{
+	const double CurrentTime = FPlatformTime::Seconds();
+
+	const uint32 Sequence = PlaybackClockSequence.load(std::memory_order_relaxed);
+	PlaybackClockSequence.store(Sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	// A new stream restarts the position at its first frame, neither the continuation of another connection nor an underrun does
+	if (InRenderedFrames > 0 && InStreamStartFrame != INDEX_NONE && InSampleRate > 0)
 	{
-		if (CurrentStream->HasStream())
-		{
-			// Use WaveFormat struct to do all of the int-float + resampling
-			FOmniverseWaveFormatInfo& WaveFormat = CurrentStream->WaveFormat;
-			int32 Stride = WaveFormat.BitsPerSample / 8;
-			// Sample numbers of steam
+		const double StartOffset = InStreamStartFrame / (double)InSampleRate;
+		PlaybackClock.Position = -StartOffset;
+		PlaybackClock.StreamStartTime = CurrentTime + StartOffset;
+	}
+	else
+	{
+		PlaybackClock.Position += PlaybackClock.BufferDuration;
+	}
 
-			int32 StreamSamples = CurrentStream->LocklessStreamBuffer.Num() / Stride;
-			if (WaveFormat.NumChannels == 1)
-			{
-				StreamSamples *= NumChannels;
-			}
-			// if stereo wave didn't contain the even number of wave samples, fix it 
-			else if (StreamSamples % 2 == 1)
+	// Audio clock of the device moves a whole buffer per callback, the stream only the frames rendered from it
+	if (InRenderedFrames > 0)
+	{
+		PlaybackClock.bStarted = true;
+	}
+	PlaybackClock.BufferDuration = InSampleRate > 0 ? FMath::Min(InRenderedFrames, InNumFrames) / (double)InSampleRate : 0.0;
+	PlaybackClock.BufferTime = CurrentTime;
+
+	PlaybackClockSequence.store(Sequence + 2, std::memory_order_release);
+}
+
+// ISubmixBufferListener
+// when called, submit samples to audio device in OnNewSubmixBuffer
+void FOmniverseSubmixListener::OnNewSubmixBuffer(const USoundSubmix* OwningSubmix, float* AudioData, int32 NumSamples, int32 NumChannels, const int32 SampleRate, double AudioClock)
+{
+	// Played by the sound generator of the character instead
+	if (AttachedGenerator.load() == nullptr)
+	{
+		Render(AudioData, NumSamples, NumChannels, SampleRate);
+	}
+}
+
+void FOmniverseSubmixListener::Render(float* AudioData, int32 NumSamples, int32 NumChannels, int32 SampleRate)
+{
+	int32 ClockRenderedFrames = 0;
+	int32 ClockStreamStartFrame = INDEX_NONE;
+	int32 InterruptSilentFrame = INDEX_NONE;
+	// What doesn't fit the voice buffer stays silent
+	const int32 NumFrames = FMath::Min(NumSamples, VoiceBuffer.Num()) / NumChannels;
+	if (bSubmixActivated && NumFrames > 0)
+	{
+		for (int32 VoiceIndex = 0; VoiceIndex < Voices.Num(); ++VoiceIndex)
+		{
+			FOmniverseStreamVoice& Voice = *Voices[VoiceIndex];
+			const FOmniverseVoiceRender VoiceRender = Voice.Render(VoiceBuffer.GetData(), NumFrames, NumChannels, SampleRate, Scratch);
+			if (VoiceRender.bHasOutput)
 			{
-				StreamSamples++;
+				MixOmniverseVoice(VoiceBuffer.GetData(), AudioData, NumFrames * NumChannels, Voice.GetGain());
 			}
+			InterruptSilentFrame = FMath::Max(InterruptSilentFrame, VoiceRender.InterruptSilentFrame);
 
-			// Get the minimal sample number
-			int32 PlaySamples = FMath::Min(NumSamples, StreamSamples);
-			auto AllocPopBuffer = [Stride, NumChannels](TArray<uint8>& Buffer, int32 AllocSamples, int WaveChannels)
+			// The playback clock follows the voice which started a stream last
+			if (VoiceRender.StreamStartFrame != INDEX_NONE)
 			{
-				int32 BufferSize = AllocSamples * Stride;
-				// Mono wave just need half samples
-				if (WaveChannels == 1)
-				{
-					BufferSize /= NumChannels;
-				}
-				Buffer.AddUninitialized(BufferSize);
-			};
-			
-			// Check if next stream can fill in
-			int32 NextFetchSamples = 0;
-			if (NumSamples - PlaySamples > 0 && CurrentStream->NextStream.IsValid())
-			{
-				auto NextStream = CurrentStream->NextStream.Get();
-				if (NextStream->WaveFormat == WaveFormat)
-				{
-					int32 NextStreamSamples = NextStream->LocklessStreamBuffer.Num() / Stride;
-					if (WaveFormat.NumChannels == 1)
-					{
-						NextStreamSamples *= NumChannels;
-					}
-
-					// Get the size which needs to fetch from next stream
-					NextFetchSamples = FMath::Min(NumSamples - PlaySamples, NextStreamSamples);
-					// New play samples
-					PlaySamples += NextFetchSamples;
-				}
+				ClockVoiceIndex = VoiceIndex;
+				ClockStreamStartFrame = VoiceRender.StreamStartFrame;
 			}
-
-			if (PlaySamples > 0)
+			if (VoiceIndex == ClockVoiceIndex)
 			{
-#if 0
-				if (WaveFormat.SamplesPerSecond != SampleRate)
-				{
-					// To get the real size to resample
-					Audio::FAlignedFloatBuffer PreResamplerInputData;
-					PreResamplerInputData.AddUninitialized(NumSamples);
-					Audio::FResamplingParameters PreResamplerParameters = {
-						Audio::EResamplingMethod::BestSinc,
-						NumChannels,
-						SampleRate,
-						WaveFormat.SamplesPerSecond,
-						PreResamplerInputData
-					};
-					int32 ResamplerSamples = FMath::Min(PlaySamples, Audio::GetOutputBufferSize(PreResamplerParameters));
-
-					// Use this real size to get the buffer to sampler
-					Audio::FAlignedFloatBuffer ResamplerInputData;
-					ResamplerInputData.AddUninitialized(ResamplerSamples);
-
-					TArray<uint8> Buffer;
-					AllocPopBuffer(Buffer, ResamplerSamples, WaveFormat.NumChannels);
-
-					int32 PopSize = CurrentStream->LocklessStreamBuffer.Pop(Buffer.GetData(), Buffer.Num());
-
-					if (PopSize < Buffer.Num() && CurrentStream->NextStream.IsValid())
-					{
-						auto NextStream = CurrentStream->NextStream.Get();
-						if (NextStream->WaveFormat == WaveFormat)
-						{
-							NextStream->LocklessStreamBuffer.Pop(Buffer.GetData() + PopSize, Buffer.Num() - PopSize);
-						}
-					}
-
-					for (int32 SampleIndex = 0, SourceSampleIndex = 0; SampleIndex < ResamplerSamples; SampleIndex += NumChannels)
-					{
-						for (int32 Channel = 0; Channel < NumChannels; ++Channel)
-						{
-							float Out;
-							int32 BufferIdx = SourceSampleIndex * Stride;
-							if (BufferIdx < Buffer.Num() && GetFloatSample(&Buffer[BufferIdx], BufferIdx, Buffer.Num(), WaveFormat.BitsPerSample, WaveFormat.SampleType, Out))
-							{
-								ResamplerInputData[SampleIndex + Channel] = Out;
-							}
-							else
-							{
-								ResamplerInputData[SampleIndex + Channel] = 0.0f;
-							}
-
-							// Mono wave need duplicate the sample
-							if (WaveFormat.NumChannels < NumChannels)
-							{
-								if (Channel == WaveFormat.NumChannels)
-								{
-									SourceSampleIndex++;
-								}
-							}
-							else
-							{
-								SourceSampleIndex++;
-							}
-						}
-					}
-
-					Audio::FResamplingParameters ResamplerParameters = {
-						Audio::EResamplingMethod::BestSinc,
-						NumChannels,
-						WaveFormat.SamplesPerSecond,
-						SampleRate,
-						ResamplerInputData
-					};
-
-					Audio::FAlignedFloatBuffer ResamplerOutputData;
-					// This buffer size should be close or equal to NumSamples
-					ResamplerOutputData.AddUninitialized(Audio::GetOutputBufferSize(ResamplerParameters));
-					Audio::FResamplerResults ResamplerResults;
-					ResamplerResults.OutBuffer = &ResamplerOutputData;
-
-					bool bResampleResult = Audio::Resample(ResamplerParameters, ResamplerResults);
-					if (bResampleResult)
-					{
-						int32 NumResamples = FMath::Min(ResamplerOutputData.Num(), NumSamples);
-						for (int32 SampleIndex = 0; SampleIndex < NumResamples; SampleIndex += NumChannels)
-						{
-							for (int32 Channel = 0; Channel < NumChannels; ++Channel)
-							{
-								AudioData[SampleIndex + Channel] += ResamplerOutputData[SampleIndex + Channel];
-							}
-						}
-					}
-				}
-				else
-#endif
-				{
-					TArray<uint8> Buffer;
-					AllocPopBuffer(Buffer, PlaySamples, WaveFormat.NumChannels);
-
-					int32 PopSize = CurrentStream->LocklessStreamBuffer.Pop(Buffer.GetData(), Buffer.Num());
-					// Fill in buffer from next stream if it's available
-					if (PopSize < Buffer.Num() && CurrentStream->NextStream.IsValid() && NextFetchSamples > 0)
-					{
-						CurrentStream->NextStream.Get()->LocklessStreamBuffer.Pop(Buffer.GetData() + PopSize, Buffer.Num() - PopSize);
-					}
-
-					for (int32 SampleIndex = 0, SourceSampleIndex = 0; SampleIndex < PlaySamples; SampleIndex += NumChannels)
-					{
-						for (int32 Channel = 0; Channel < NumChannels; ++Channel)
-						{
-							float Out;
-							int32 BufferIdx = SourceSampleIndex * Stride;
-							if (BufferIdx < Buffer.Num() && GetFloatSample(&Buffer[BufferIdx], BufferIdx, Buffer.Num(), WaveFormat.BitsPerSample, WaveFormat.SampleType, Out))
-							{
-								AudioData[SampleIndex + Channel] += Out;
-							}
-
-							// Mono wave need duplicate the sample
-							if (WaveFormat.NumChannels < NumChannels)
-							{
-								if (Channel == WaveFormat.NumChannels)
-								{
-									SourceSampleIndex++;
-								}
-							}
-							else
-							{
-								SourceSampleIndex++;
-							}
-						}
-					}
-				}
+				ClockRenderedFrames = VoiceRender.RenderedFrames;
 			}
 		}
 
-		TrySwitchToNextStream();
+		if (InterruptSilentFrame != INDEX_NONE)
+		{
+			RecordInterrupt(InterruptSilentFrame, SampleRate);
+		}
 	}
+
+	UpdatePlaybackClock(ClockStreamStartFrame, ClockRenderedFrames, NumSamples / NumChannels, SampleRate);
 }
 
 #undef LOCTEXT_NAMESPACE
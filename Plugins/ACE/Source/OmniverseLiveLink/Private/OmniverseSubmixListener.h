@@ -11,7 +11,12 @@
 #include "AudioDevice.h"
 #include "ISubmixBufferListener.h"
 #include "OmniverseWaveDef.h"
+#include "OmniverseStreamVoice.h"
+#include <atomic>
 
+// Plays the streams of a source into the master submix of the main audio device, or into a sound generator
+// of a component attached to the character, which then plays them instead.
+// Each connection plays on a voice of its own, so the utterances of several senders are mixed instead of queued
 class FOmniverseSubmixListener : public ISubmixBufferListener
 {
 public:
@@ -22,13 +27,59 @@ public:
 	void Activate();
 	void Deactivate();
 
+	// Size the render state for device buffers up to InMaxBufferFrames and start rendering, Activate() does it for its device.
+	// Render() allocates nothing after it
+	void ActivateRender(int32 InMaxBufferFrames);
+	// Audio render thread of the main device: mix the playing streams to the buffer
+	void Render(float* AudioData, int32 NumSamples, int32 NumChannels, int32 SampleRate);
+	// One generator at a time plays the streams, false if another one is attached
+	bool AttachGenerator(const void* InGenerator);
+	void DetachGenerator(const void* InGenerator);
+	bool IsGeneratorAttached(const void* InGenerator) const { return AttachedGenerator.load() == InGenerator; }
+	// Largest buffer Render() fills at once
+	int32 GetMaxBufferFrames() const { return MaxBufferFrames; }
+
 	void SetSampleRate(uint32 InSampleRate)
 	{
 		SubmixSampleRate = InSampleRate;
 	}
 
-	void AddNewWave(const FOmniverseWaveFormatInfo& Format);
-	void AppendStream(const uint8* Data, int32 Size);
+	// Producer thread: a header starts a new stream in its format on the voice of the connection,
+	// the samples of a connection are appended in the format of its last header
+	void BeginStream(const FOmniverseWaveFormatInfo& Format, uint32 ConnectionId);
+	void AppendStream(const uint8* Data, int32 Size, uint32 ConnectionId);
+	// The stream of the connection ended, running dry after it is no underrun, its voice is free once played
+	void EndStream(uint32 ConnectionId);
+	// Any thread: what is queued to the voices fades out in the next buffer and is dropped, the later streams play
+	void Interrupt();
+
+	// Summed over the voices, the longest underrun and the peak fill of any voice
+	FOmniverseAudioRingStats GetRingStats() const;
+	FOmniverseUnderrunStats GetUnderrunStats() const;
+	int32 GetNumVoices() const { return Voices.Num(); }
+	void SetVoiceGain(int32 InVoiceIndex, float InGain);
+	// Seconds from the interrupts to the silence of the buffer rendered after them, returns the number of interrupts
+	int32 GetInterruptStats(double& OutLastLatency, double& OutMaxLatency) const;
+
+	// Seconds of the playing stream rendered by the audio device, interpolated inside the current buffer.
+	// OutStreamStartTime is the platform time its first buffer was rendered. False if no stream is rendering
+	bool GetPlaybackPosition(double& OutPosition, double& OutStreamStartTime) const;
+
+#if WITH_DEV_AUTOMATION_TESTS
+	// Allocations of the buffers of Render(), see FOmniverseRenderCheck
+	uint32 HashRenderBuffers() const
+	{
+		uint32 Hash = FOmniverseRenderCheck::HashBuffer(Voices, 0);
+		Hash = FOmniverseRenderCheck::HashBuffer(Scratch.PopBuffer, Hash);
+		Hash = FOmniverseRenderCheck::HashBuffer(Scratch.ResampleBuffer, Hash);
+		Hash = FOmniverseRenderCheck::HashBuffer(VoiceBuffer, Hash);
+		for (const TUniquePtr<FOmniverseStreamVoice>& Voice : Voices)
+		{
+			Hash = Voice->HashRenderBuffers(Hash);
+		}
+		return Hash;
+	}
+#endif
 
 protected:
 	// ISubmixBufferListener
@@ -36,30 +87,67 @@ protected:
 	virtual void OnNewSubmixBuffer(const USoundSubmix* OwningSubmix, float* AudioData, int32 NumSamples, int32 NumChannels, const int32 SampleRate, double AudioClock) override;
 	
 private:
-	struct FWaveStream
-	{
-		FWaveStream(const FOmniverseWaveFormatInfo& NewWaveFormat, uint32 Capacity)
-			: WaveFormat(NewWaveFormat)
-			, NextStream(nullptr)
-		{
-			LocklessStreamBuffer.SetCapacity(Capacity);
-		}
+	void OnDeviceDestroyed(Audio::FDeviceId InDeviceId);
+	void ReleaseAudioDevice();
+	// Producer thread: the voice the connection plays on, a free one for a new connection
+	FOmniverseStreamVoice* AssignVoice(uint32 ConnectionId);
+	void UpdatePlaybackClock(int32 InStreamStartFrame, int32 InRenderedFrames, int32 InNumFrames, int32 InSampleRate);
+	void RecordInterrupt(int32 InSilentFrame, int32 InSampleRate);
 
-		bool HasStream() { return LocklessStreamBuffer.Num() > 0; }
+	// Audio position of the playing stream, updated by each submix buffer.
+	// Counted in the stream frames rendered, the audio clock of the device also moves through underruns and the silence
+	// before a stream, and a sound generator has none
+	struct FPlaybackClock
+	{
+		bool bStarted = false;
+		double StreamStartTime = 0.0;
+		// Stream seconds before the last buffer, and the stream seconds in it
+		double Position = 0.0;
+		double BufferDuration = 0.0;
+		// Platform time of the last buffer
+		double BufferTime = 0.0;
+	};
 
-		FOmniverseWaveFormatInfo WaveFormat;
-		mutable Audio::TCircularAudioBuffer<uint8> LocklessStreamBuffer;
-		TSharedPtr<FWaveStream> NextStream;
+	// Connection playing on a voice, and whether its stream ended
+	struct FVoiceOwner
+	{
+		uint32 ConnectionId = 0;
+		bool bEnded = false;
 	};
 
-	void OnDeviceDestroyed(Audio::FDeviceId InDeviceId);
-	void TrySwitchToNextStream();
+	// Fixed set, each voice ring sized by omni.WaveStreamBufferSize when the listener is created
+	TArray<TUniquePtr<FOmniverseStreamVoice>> Voices;
+
+	// Producer thread: format of the last header of each connection, and the voice it plays on
+	TMap<uint32, FOmniverseWaveFormatInfo> ConnectionFormats;
+	TMap<uint32, int32> ConnectionVoices;
+	TArray<FVoiceOwner> VoiceOwners;
+	double LastOverflowLogTime = 0.0;
+
+	// Scratch of the audio render thread, sized at activation for a device buffer of any stream format.
+	// Nothing is allocated or locked in OnNewSubmixBuffer
+	FOmniverseVoiceScratch Scratch;
+	TArray<float> VoiceBuffer;
+	int32 MaxBufferSamples = 0;
+	int32 MaxBufferFrames = 0;
+	// The voice which started a stream last, the animation is synced to it
+	int32 ClockVoiceIndex = 0;
+
+	// Platform time of the interrupt not rendered yet, 0 if none
+	std::atomic<double> InterruptTime = 0.0;
+	// Written by the audio render thread only
+	std::atomic<int32> NumInterrupts = 0;
+	std::atomic<double> LastInterruptLatency = 0.0;
+	std::atomic<double> MaxInterruptLatency = 0.0;
 
-	// Valid in Audio thread
-	TSharedPtr<FWaveStream, ESPMode::ThreadSafe> PlayingStream = nullptr;
-	TWeakPtr<FWaveStream, ESPMode::ThreadSafe> LastPlayingStream = nullptr;
+	// Written by the audio render thread only, readers retry while the sequence is odd or changed
+	FPlaybackClock PlaybackClock;
+	std::atomic<uint32> PlaybackClockSequence = 0;
 
 	FThreadSafeBool bSubmixActivated = false;
+	std::atomic<const void*> AttachedGenerator = nullptr;
+	// Device of the source at its own rate, created with the audio thread stopped. The main device otherwise
+	bool bOwnsAudioDevice = false;
 	FAudioDeviceHandle AudioDeviceHandle;
 	FDelegateHandle DeviceDestroyedHandle;
 	uint32 SubmixSampleRate = 16000;
@@ -10,24 +10,159 @@
 #include "ACEPrivate.h"
 #include "OmniverseLiveLinkSourceSettings.h"
 #include "OmniverseSubmixListener.h"
+#include "OmniverseOpusDecoder.h"
 
 #include "ILiveLinkClient.h"
+#include "OmniverseRenderCheck.h"
 
 #define LOCTEXT_NAMESPACE "OmniverseWaveStreamer"
 
 
+TMap<uint32, TWeakPtr<FOmniverseSubmixListener, ESPMode::ThreadSafe>> FOmniverseWaveStreamer::SubmixListeners;
+TMultiMap<uint32, TWeakPtr<FOmniverseSubmixListenerBinding, ESPMode::ThreadSafe>> FOmniverseWaveStreamer::SubmixListenerBindings;
+FCriticalSection FOmniverseWaveStreamer::SubmixListenersLock;
+
+void FOmniverseSubmixListenerBinding::Offer(TSharedPtr<FOmniverseSubmixListener, ESPMode::ThreadSafe> InListener)
+{
+	// Take back the listener not taken yet, or wait for the one being taken
+	int32 Expected = Offered;
+	if (!State.compare_exchange_strong(Expected, Empty, std::memory_order_acquire))
+	{
+		while (State.load(std::memory_order_acquire) == Taking)
+		{
+			FPlatformProcess::YieldThread();
+		}
+	}
+
+	// Releases the listener returned by the render thread
+	Listener = MoveTemp(InListener);
+	State.store(Offered, std::memory_order_release);
+}
+
+bool FOmniverseSubmixListenerBinding::Take(TSharedPtr<FOmniverseSubmixListener, ESPMode::ThreadSafe>& InOutListener)
+{
+	int32 Expected = Offered;
+	if (!State.compare_exchange_strong(Expected, Taking, std::memory_order_acquire))
+	{
+		return false;
+	}
+
+	Swap(InOutListener, Listener);
+	State.store(Returned, std::memory_order_release);
+	return true;
+}
+
 FOmniverseWaveStreamer::FOmniverseWaveStreamer(uint32 InPort, uint32 InSampleRate)
     : FOmniverseBaseListener(InPort)
+	, Port(InPort)
 {
 	SubmixListener = MakeShareable(new FOmniverseSubmixListener());
 	SubmixListener->SetSampleRate(InSampleRate);
+
+	FOmniverseScopeLock Lock(&SubmixListenersLock);
+	SubmixListeners.Add(Port, SubmixListener);
+	OfferSubmixListener(Port, SubmixListener);
 }
 
 FOmniverseWaveStreamer::~FOmniverseWaveStreamer()
 {
+	{
+		FOmniverseScopeLock Lock(&SubmixListenersLock);
+		// Another source may listen on the port now
+		if (SubmixListeners.FindRef(Port).Pin() == SubmixListener)
+		{
+			SubmixListeners.Remove(Port);
+			OfferSubmixListener(Port, nullptr);
+		}
+	}
 	SubmixListener.Reset();
 }
 
+TSharedPtr<FOmniverseSubmixListener, ESPMode::ThreadSafe> FOmniverseWaveStreamer::FindSubmixListener(uint32 InPort)
+{
+	FOmniverseScopeLock Lock(&SubmixListenersLock);
+	return SubmixListeners.FindRef(InPort).Pin();
+}
+
+TSharedRef<FOmniverseSubmixListenerBinding, ESPMode::ThreadSafe> FOmniverseWaveStreamer::BindSubmixListener(uint32 InPort, TSharedPtr<FOmniverseSubmixListener, ESPMode::ThreadSafe>& OutListener)
+{
+	TSharedRef<FOmniverseSubmixListenerBinding, ESPMode::ThreadSafe> Binding = MakeShared<FOmniverseSubmixListenerBinding, ESPMode::ThreadSafe>();
+
+	FOmniverseScopeLock Lock(&SubmixListenersLock);
+	OutListener = SubmixListeners.FindRef(InPort).Pin();
+	SubmixListenerBindings.Add(InPort, Binding);
+	return Binding;
+}
+
+void FOmniverseWaveStreamer::OfferSubmixListener(uint32 InPort, TSharedPtr<FOmniverseSubmixListener, ESPMode::ThreadSafe> InListener)
+{
+	for (auto It = SubmixListenerBindings.CreateKeyIterator(InPort); It; ++It)
+	{
+		if (TSharedPtr<FOmniverseSubmixListenerBinding, ESPMode::ThreadSafe> Binding = It.Value().Pin())
+		{
+			Binding->Offer(InListener);
+		}
+		else
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void FOmniverseWaveStreamer::DumpAudioStreamBuffers()
+{
+	FOmniverseScopeLock Lock(&SubmixListenersLock);
+	for (const auto& Pair : SubmixListeners)
+	{
+		if (TSharedPtr<FOmniverseSubmixListener, ESPMode::ThreadSafe> Listener = Pair.Value.Pin())
+		{
+			const FOmniverseAudioRingStats Stats = Listener->GetRingStats();
+			const FOmniverseUnderrunStats Underruns = Listener->GetUnderrunStats();
+			UE_LOG(LogACE, Display, TEXT("Audio port %u, %d voices: %lld / %lld bytes buffered, peak %lld, %lld bytes dropped in %lld overflows, %d underruns of %.1f ms (longest %.1f ms)"),
+				Pair.Key, Listener->GetNumVoices(), Stats.FillBytes, Stats.Capacity, Stats.PeakFillBytes, Stats.DroppedBytes, Stats.NumOverflows,
+				Underruns.NumUnderruns, Underruns.TotalSeconds * 1000.0, Underruns.MaxSeconds * 1000.0);
+
+			double LastLatency = 0.0;
+			double MaxLatency = 0.0;
+			const int32 NumInterrupts = Listener->GetInterruptStats(LastLatency, MaxLatency);
+			if (NumInterrupts > 0)
+			{
+				UE_LOG(LogACE, Display, TEXT("Audio port %u: %d interrupts, silent %.1f ms after the last one (longest %.1f ms)"),
+					Pair.Key, NumInterrupts, LastLatency * 1000.0, MaxLatency * 1000.0);
+			}
+		}
+	}
+}
+
+static FAutoConsoleCommand CmdOmniverseDumpAudioStreamBuffers(
+	TEXT("omni.DumpAudioStreamBuffers"),
+	TEXT("Logs the fill level, the underruns and the interrupt latency of the audio stream buffer of each source.\n"),
+	FConsoleCommandDelegate::CreateStatic(&FOmniverseWaveStreamer::DumpAudioStreamBuffers));
+
+static void SetAudioVoiceGain(const TArray<FString>& Args)
+{
+	if (Args.Num() < 3)
+	{
+		UE_LOG(LogACE, Warning, TEXT("Usage: omni.SetAudioVoiceGain <port> <voice> <gain>"));
+		return;
+	}
+
+	const uint32 AudioPort = FCString::Atoi(*Args[0]);
+	TSharedPtr<FOmniverseSubmixListener, ESPMode::ThreadSafe> Listener = FOmniverseWaveStreamer::FindSubmixListener(AudioPort);
+	const int32 VoiceIndex = FCString::Atoi(*Args[1]);
+	if (!Listener.IsValid() || VoiceIndex < 0 || VoiceIndex >= Listener->GetNumVoices())
+	{
+		UE_LOG(LogACE, Warning, TEXT("No audio voice %d on port %u."), VoiceIndex, AudioPort);
+		return;
+	}
+	Listener->SetVoiceGain(VoiceIndex, FMath::Max(FCString::Atof(*Args[2]), 0.0f));
+}
+
+static FAutoConsoleCommand CmdOmniverseSetAudioVoiceGain(
+	TEXT("omni.SetAudioVoiceGain"),
+	TEXT("Scales a voice of the audio streams of a source: omni.SetAudioVoiceGain <port> <voice> <gain>, 1 is unchanged.\n"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&SetAudioVoiceGain));
+
 // FRunnable interface
 void FOmniverseWaveStreamer::Start()
 {
@@ -41,14 +176,17 @@ void FOmniverseWaveStreamer::Stop()
 	SubmixListener->Deactivate();
 }
 
-void FOmniverseWaveStreamer::OnPackageDataReceived(const uint8* InPackageData, int32 InPackageSize)
+void FOmniverseWaveStreamer::OnPackageDataReceived(const uint8* InPackageData, int32 InPackageSize, uint32 InConnectionId)
 {
-	ParseWave(InPackageData, InPackageSize);
+	ParseWave(InPackageData, InPackageSize, InConnectionId);
 }
 
-void FOmniverseWaveStreamer::OnPackageDataPushed(const uint8* InPackageData, int32 InPackageSize, double DeltaTime, bool bBegin, bool bEnd)
+void FOmniverseWaveStreamer::OnPackageDataPushed(const uint8* InPackageData, int32 InPackageSize, uint32 InConnectionId, double DeltaTime, bool bBegin, bool bEnd)
 {
-	FOmniverseLiveLinkFramePlayer::Get().PushAudioData_AnyThread(InPackageData, InPackageSize, DeltaTime, bBegin, bEnd);
+	if (FramePlayer)
+	{
+		FramePlayer->PushAudioData_AnyThread(InPackageData, InPackageSize, InConnectionId, DeltaTime, bBegin, bEnd);
+	}
 }
 
 uint32 FOmniverseWaveStreamer::GetDelayTime() const
@@ -58,13 +196,31 @@ uint32 FOmniverseWaveStreamer::GetDelayTime() const
 		UOmniverseLiveLinkSourceSettings* Settings = Cast<UOmniverseLiveLinkSourceSettings>(LiveLinkClient->GetSourceSettings(SourceGuid));
 		if (Settings)
 		{
-			return Settings->AudioDelayTime;
+			if (!Settings->bAdaptiveDelay || !FramePlayer)
+			{
+				return Settings->AudioDelayTime;
+			}
+
+			FOmniverseJitterBuffer& JitterBuffer = FramePlayer->GetAudioJitterBuffer();
+			JitterBuffer.SetBounds(Settings->AudioMinDelayTime / 1000.0, Settings->AudioMaxDelayTime / 1000.0, Settings->TargetLatePercentage / 100.0);
+			return FMath::RoundToInt(JitterBuffer.GetDelay() * 1000.0);
 		}
 	}
 
 	return 0;
 }
 
+void FOmniverseWaveStreamer::OnInterrupt()
+{
+	FOmniverseBaseListener::OnInterrupt();
+	SubmixListener->Interrupt();
+}
+
+bool FOmniverseWaveStreamer::GetPlaybackPosition(double& OutPosition, double& OutStreamStartTime) const
+{
+	return SubmixListener->GetPlaybackPosition(OutPosition, OutStreamStartTime);
+}
+
 bool FOmniverseWaveStreamer::IsHeaderPackage(const uint8* InPackageData, int32 InPackageSize) const
 {
 	const char MagicWord[] = { 'W', 'A', 'V', 'E' };
@@ -87,10 +243,11 @@ bool FOmniverseWaveStreamer::IsHeaderPackage(const uint8* InPackageData, int32 I
 	return bIsHeader;
 }
 
-void FOmniverseWaveStreamer::ParseWave(const uint8* InReceivedData, int32 InReceivedSize)
+void FOmniverseWaveStreamer::ParseWave(const uint8* InReceivedData, int32 InReceivedSize, uint32 InConnectionId)
 {
 	if (IsEOSPackage(InReceivedData, InReceivedSize))
 	{
+		SubmixListener->EndStream(InConnectionId);
 		return;
 	}
 
@@ -100,28 +257,129 @@ void FOmniverseWaveStreamer::ParseWave(const uint8* InReceivedData, int32 InRece
 	
 	if (IsHeaderPackage(InReceivedData, InReceivedSize))
 	{
-		FString ReceievedString = FString(InReceivedSize, (ANSICHAR*)InReceivedData);
-		UE_LOG(LogACE, Warning, TEXT("Received wave format info: '%s'"), *ReceievedString);
-		
-		FOmniverseWaveFormatInfo WaveInfo;
+		UE_LOG(LogACE, Warning, TEXT("Received wave format info: '%s'"), *FString(InReceivedSize, (ANSICHAR*)InReceivedData));
 
-		TArray<FString> WaveFormatInfoStrings;
-		ReceievedString.ParseIntoArray(WaveFormatInfoStrings, *HeaderSeparator);
-		if (WaveFormatInfoStrings.Num() == FOmniverseWaveFormatInfo::NumMembers + 1)
+		FOmniverseWaveFormatInfo WaveInfo;
+		if (ParseWaveHeader(InReceivedData, InReceivedSize, WaveInfo))
 		{
-			int32 InfoIndex = 1; // The first is MagicWord
-			WaveInfo.SamplesPerSecond = FCString::Atoi(*WaveFormatInfoStrings[InfoIndex++]);
-			WaveInfo.NumChannels = FCString::Atoi(*WaveFormatInfoStrings[InfoIndex++]);
-			WaveInfo.BitsPerSample = FCString::Atoi(*WaveFormatInfoStrings[InfoIndex++]);
-			WaveInfo.SampleType = FCString::Atoi(*WaveFormatInfoStrings[InfoIndex++]);
-			SubmixListener->AddNewWave(WaveInfo);
+			SubmixListener->BeginStream(WaveInfo, InConnectionId);
 		}
 	}
 	else
 	{
 		//UE_LOG(LogACE, Warning, TEXT("Wav bytes received: %i"), ReceivedData.Num());
-		SubmixListener->AppendStream(InReceivedData, InReceivedSize);
+		SubmixListener->AppendStream(InReceivedData, InReceivedSize, InConnectionId);
+	}
+}
+
+bool FOmniverseWaveStreamer::ParseWaveHeader(const uint8* InReceivedData, int32 InReceivedSize, FOmniverseWaveFormatInfo& OutWaveInfo)
+{
+	FString ReceievedString = FString(InReceivedSize, (ANSICHAR*)InReceivedData);
+
+	TArray<FString> WaveFormatInfoStrings;
+	ReceievedString.ParseIntoArray(WaveFormatInfoStrings, *HeaderSeparator);
+	if (WaveFormatInfoStrings.Num() != FOmniverseWaveFormatInfo::NumMembers + 1)
+	{
+		return false;
+	}
+
+	int32 InfoIndex = 1; // The first is MagicWord
+	OutWaveInfo.SamplesPerSecond = FCString::Atoi(*WaveFormatInfoStrings[InfoIndex++]);
+	OutWaveInfo.NumChannels = FCString::Atoi(*WaveFormatInfoStrings[InfoIndex++]);
+	OutWaveInfo.BitsPerSample = FCString::Atoi(*WaveFormatInfoStrings[InfoIndex++]);
+	OutWaveInfo.SampleType = FCString::Atoi(*WaveFormatInfoStrings[InfoIndex++]);
+	return true;
+}
+
+bool FOmniverseWaveStreamer::DecodePackage(const uint8*& InOutPackageData, int32& InOutPackageSize, uint32 InConnectionId)
+{
+	if (IsEOSPackage(InOutPackageData, InOutPackageSize))
+	{
+		return true;
+	}
+
+	if (IsHeaderPackage(InOutPackageData, InOutPackageSize))
+	{
+		// Each header starts a new stream, with a new decoder
+		OpusDecoders.Remove(InConnectionId);
+		StreamFormats.Remove(InConnectionId);
+		UndecodableStreams.Remove(InConnectionId);
+
+		FOmniverseWaveFormatInfo WaveInfo;
+		if (!ParseWaveHeader(InOutPackageData, InOutPackageSize, WaveInfo))
+		{
+			return true;
+		}
+
+		if (WaveInfo.SampleType != OMNIVERSE_WAVE_FORMAT_OPUS)
+		{
+			StreamFormats.Add(InConnectionId, WaveInfo);
+		}
+		else
+		{
+			TUniquePtr<FOmniverseOpusDecoder> Decoder = MakeUnique<FOmniverseOpusDecoder>();
+			if (Decoder->Init(WaveInfo.SamplesPerSecond, WaveInfo.NumChannels))
+			{
+				OpusDecoders.Add(InConnectionId, MoveTemp(Decoder));
+
+				// Played as the float frames it's decoded to
+				const FString Header = FString::Printf(TEXT("WAVE%s%d%s%d%s32%s3"), *HeaderSeparator, WaveInfo.SamplesPerSecond, *HeaderSeparator, WaveInfo.NumChannels, *HeaderSeparator, *HeaderSeparator);
+				DecodedHeader.SetNumUninitialized(Header.Len());
+				FMemory::Memcpy(DecodedHeader.GetData(), TCHAR_TO_ANSI(*Header), Header.Len());
+				InOutPackageData = (const uint8*)DecodedHeader.GetData();
+				InOutPackageSize = DecodedHeader.Num();
+
+				WaveInfo.BitsPerSample = 32;
+				WaveInfo.SampleType = 3;
+				StreamFormats.Add(InConnectionId, WaveInfo);
+			}
+			else
+			{
+				// Its packets would be played as PCM, the stream is dropped up to the next header
+				UndecodableStreams.Add(InConnectionId);
+				return false;
+			}
+		}
+		return true;
 	}
+
+	if (UndecodableStreams.Contains(InConnectionId))
+	{
+		return false;
+	}
+
+	TUniquePtr<FOmniverseOpusDecoder>* Decoder = OpusDecoders.Find(InConnectionId);
+	if (Decoder == nullptr)
+	{
+		return true;
+	}
+
+	// Valid until the next package of the connection, the frame player copies it
+	const float* DecodedAudio = nullptr;
+	const int32 NumFrames = (*Decoder)->Decode(InOutPackageData, InOutPackageSize, DecodedAudio);
+	InOutPackageData = (const uint8*)DecodedAudio;
+	InOutPackageSize = NumFrames * (*Decoder)->GetNumChannels() * sizeof(float);
+	return NumFrames > 0;
+}
+
+bool FOmniverseWaveStreamer::GetPackageDuration(const uint8* InPackageData, int32 InPackageSize, uint32 InConnectionId, double& OutDuration) const
+{
+	const FOmniverseWaveFormatInfo* WaveInfo = StreamFormats.Find(InConnectionId);
+	if (WaveInfo == nullptr || WaveInfo->SamplesPerSecond <= 0 || WaveInfo->NumChannels <= 0 || WaveInfo->BitsPerSample < 8)
+	{
+		return false;
+	}
+
+	const int32 FrameSize = WaveInfo->NumChannels * (WaveInfo->BitsPerSample / 8);
+	OutDuration = (double)(InPackageSize / FrameSize) / WaveInfo->SamplesPerSecond;
+	return true;
+}
+
+void FOmniverseWaveStreamer::OnConnectionClosed(uint32 InConnectionId)
+{
+	OpusDecoders.Remove(InConnectionId);
+	StreamFormats.Remove(InConnectionId);
+	UndecodableStreams.Remove(InConnectionId);
 }
 
 #undef LOCTEXT_NAMESPACE
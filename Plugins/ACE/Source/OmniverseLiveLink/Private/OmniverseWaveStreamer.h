@@ -10,6 +10,30 @@
 #include "CoreMinimal.h"
 #include "OmniverseWaveDef.h"
 #include "OmniverseBaseListener.h"
+#include <atomic>
+
+// Submix listener handed by the source on a port to a sound generator rendering it, the render thread takes it without a lock.
+// The listener it replaces goes back in the binding, so it's never released on the render thread
+class FOmniverseSubmixListenerBinding
+{
+public:
+	// In the SubmixListenersLock: the listener of the source created on the port, or none when it's destroyed
+	void Offer(TSharedPtr<class FOmniverseSubmixListener, ESPMode::ThreadSafe> InListener);
+	// Audio render thread: swaps in the offered listener, true if there was one
+	bool Take(TSharedPtr<class FOmniverseSubmixListener, ESPMode::ThreadSafe>& InOutListener);
+
+private:
+	enum EState : int32
+	{
+		Empty,
+		Offered,
+		Taking,
+		Returned,
+	};
+
+	std::atomic<int32> State = Empty;
+	TSharedPtr<class FOmniverseSubmixListener, ESPMode::ThreadSafe> Listener;
+};
 
 class FOmniverseWaveStreamer : public FOmniverseBaseListener
 {
@@ -19,15 +43,44 @@ public:
 
 	virtual void Stop() override;
 	virtual void Start() override;
-	virtual void OnPackageDataReceived(const uint8* InPackageData, int32 InPackageSize) override;
-	virtual void OnPackageDataPushed(const uint8* InPackageData, int32 InPackageSize, double DeltaTime, bool bBegin = false, bool bEnd = false) override;
+	virtual void OnPackageDataReceived(const uint8* InPackageData, int32 InPackageSize, uint32 InConnectionId) override;
+	virtual void OnPackageDataPushed(const uint8* InPackageData, int32 InPackageSize, uint32 InConnectionId, double DeltaTime, bool bBegin = false, bool bEnd = false) override;
 	virtual uint32 GetDelayTime() const override;
+	virtual bool GetPlaybackPosition(double& OutPosition, double& OutStreamStartTime) const override;
 	virtual bool IsHeaderPackage(const uint8* InPackageData, int32 InPackageSize) const override;
+	virtual bool DecodePackage(const uint8*& InOutPackageData, int32& InOutPackageSize, uint32 InConnectionId) override;
+	virtual bool GetPackageDuration(const uint8* InPackageData, int32 InPackageSize, uint32 InConnectionId, double& OutDuration) const override;
+	virtual void OnConnectionClosed(uint32 InConnectionId) override;
+	virtual void OnInterrupt() override;
+
+	// Streams of the source listening on the audio port, played by the sound generators of the characters
+	static TSharedPtr<class FOmniverseSubmixListener, ESPMode::ThreadSafe> FindSubmixListener(uint32 InPort);
+	// Not on the audio render thread: the listener on the port now, and the binding the sources created or destroyed later offer theirs to
+	static TSharedRef<FOmniverseSubmixListenerBinding, ESPMode::ThreadSafe> BindSubmixListener(uint32 InPort, TSharedPtr<class FOmniverseSubmixListener, ESPMode::ThreadSafe>& OutListener);
+	// Fill level and underruns of the stream buffer of each source, omni.DumpAudioStreamBuffers
+	static void DumpAudioStreamBuffers();
 
 private:
-    void ParseWave(const uint8* InReceivedData, int32 InReceivedSize);
+    void ParseWave(const uint8* InReceivedData, int32 InReceivedSize, uint32 InConnectionId);
+	// "WAVE:SamplesPerSecond:Channels:BitsPerSample:SampleType"
+	static bool ParseWaveHeader(const uint8* InReceivedData, int32 InReceivedSize, FOmniverseWaveFormatInfo& OutWaveInfo);
 
 private:
 
-	TSharedPtr<class FOmniverseSubmixListener> SubmixListener;
+	TSharedPtr<class FOmniverseSubmixListener, ESPMode::ThreadSafe> SubmixListener;
+	uint32 Port;
+
+	// Socket thread: decoder of the Opus stream of each connection, and the float header its packages are played with
+	TMap<uint32, TUniquePtr<class FOmniverseOpusDecoder>> OpusDecoders;
+	TArray<ANSICHAR> DecodedHeader;
+	// Socket thread: connections of an Opus stream the decoder failed to start for, their packets are dropped
+	TSet<uint32> UndecodableStreams;
+	// Socket thread: format of the stream of each connection as it's pushed, after decoding
+	TMap<uint32, FOmniverseWaveFormatInfo> StreamFormats;
+
+	static TMap<uint32, TWeakPtr<class FOmniverseSubmixListener, ESPMode::ThreadSafe>> SubmixListeners;
+	static TMultiMap<uint32, TWeakPtr<FOmniverseSubmixListenerBinding, ESPMode::ThreadSafe>> SubmixListenerBindings;
+	static FCriticalSection SubmixListenersLock;
+	// In the SubmixListenersLock, the bindings of the generators destroyed are dropped
+	static void OfferSubmixListener(uint32 InPort, TSharedPtr<class FOmniverseSubmixListener, ESPMode::ThreadSafe> InListener);
 };
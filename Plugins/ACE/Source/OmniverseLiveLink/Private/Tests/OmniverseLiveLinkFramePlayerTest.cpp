@@ -0,0 +1,173 @@
+// Copyright(c) 2022-2023, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+#include "Interfaces/IPluginManager.h"
+#include "Math/RandomStream.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "OmniverseFrameScheduler.h"
+#include "OmniverseLiveLinkFramePlayer.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// Frame rate simple_socket_sender.py sends the bundled animation at, "A2F:30"
+#define TEST_ANIMATION_FPS 30.0
+// Pending time of the first frame, the default animation delay
+#define TEST_DELAY_SECONDS 0.1
+// Release lateness of the scheduler thread, and one stall of it below the rebase of the timeline
+#define TEST_MAX_LATENESS_SECONDS 0.002
+#define TEST_STALL_SECONDS 0.1
+// Frames released by the scheduler, a second of animation, each woken up to this late
+#define TEST_RELEASED_FRAMES 30
+#define TEST_WAKE_LATENCY_SECONDS 0.0005
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FOmniverseStreamTimelineTest, "Omniverse.LiveLink.FramePlayer.StreamTimeline", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FOmniverseStreamTimelineTest::RunTest(const FString& Parameters)
+{
+	// The frames of the bundled A2F export, keyed by their index
+	TSharedPtr<IPlugin> Plugin = IPluginManager::Get().FindPlugin(TEXT("OmniverseLiveLink"));
+	if (!TestTrue(TEXT("OmniverseLiveLink plugin found"), Plugin.IsValid()))
+	{
+		return false;
+	}
+
+	const FString FileName = Plugin->GetBaseDir() / TEXT("Test") / TEXT("a2f_out_ue_p3_neutral.json");
+	FString JsonString;
+	TSharedPtr<FJsonObject> JsonObject;
+	if (!TestTrue(TEXT("Animation file loaded"), FFileHelper::LoadFileToString(JsonString, *FileName))
+		|| !TestTrue(TEXT("Animation file parsed"), FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(JsonString), JsonObject) && JsonObject.IsValid()))
+	{
+		return false;
+	}
+	const int32 NumFrames = JsonObject->Values.Num();
+	TestTrue(TEXT("Animation frames"), NumFrames > 1);
+
+	// The stream as the listener pushes it, each frame as simple_socket_sender.py sends it
+	TSharedPtr<FOmniverseLiveLinkFramePlayer, ESPMode::ThreadSafe> FramePlayer = MakeShared<FOmniverseLiveLinkFramePlayer, ESPMode::ThreadSafe>();
+	const FString Header = FString::Printf(TEXT("A2F:%d"), (int32)TEST_ANIMATION_FPS);
+	const uint8 EndOfStream[] = { 'E', 'O', 'S' };
+	FramePlayer->PushAnimeData_AnyThread((const uint8*)TCHAR_TO_ANSI(*Header), Header.Len(), 1, 0.0, true, false);
+	for (int32 FrameIndex = 0; FrameIndex < NumFrames; ++FrameIndex)
+	{
+		const TSharedPtr<FJsonObject>* FrameObject = nullptr;
+		if (!TestTrue(FString::Printf(TEXT("Frame %d found"), FrameIndex), JsonObject->TryGetObjectField(FString::FromInt(FrameIndex), FrameObject)))
+		{
+			return false;
+		}
+
+		FString FrameString;
+		FJsonSerializer::Serialize(FrameObject->ToSharedRef(), TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&FrameString));
+		const FTCHARToUTF8 FrameData(*FrameString);
+		FramePlayer->PushAnimeData_AnyThread((const uint8*)FrameData.Get(), FrameData.Length(), 1, FrameIndex == 0 ? TEST_DELAY_SECONDS : 1.0 / TEST_ANIMATION_FPS, false, false);
+	}
+	FramePlayer->PushAnimeData_AnyThread(EndOfStream, sizeof(EndOfStream), 1, 0.0, false, true);
+
+	// Ticked as the scheduler thread does, not registered to it: at the deadline a little late, again at once after a release.
+	// It stalls once in the middle, less than the rebase of the timeline
+	FRandomStream Random(NumFrames);
+	double CurrentTime = FPlatformTime::Seconds();
+	double Deadline = 0.0;
+	int32 NumReleases = 0;
+	for (;;)
+	{
+		if (FramePlayer->Tick(CurrentTime, Deadline))
+		{
+			if (++NumReleases == NumFrames / 2)
+			{
+				CurrentTime += TEST_STALL_SECONDS;
+			}
+			continue;
+		}
+
+		if (Deadline == DBL_MAX)
+		{
+			break;
+		}
+		CurrentTime = FMath::Max(Deadline, CurrentTime) + Random.GetFraction() * TEST_MAX_LATENESS_SECONDS;
+	}
+	TestEqual(TEXT("Packages released"), NumReleases, NumFrames + 2);
+
+	// The lateness doesn't compound, the last frame is released at its index and late by one release at most
+	const FOmniverseLiveLinkFramePlayer::FStreamTimeline& Timeline = FramePlayer->GetAnimeTimeline();
+	const double IdealEndTime = Timeline.StartTime + TEST_DELAY_SECONDS + (NumFrames - 1) / TEST_ANIMATION_FPS;
+	const double ReleaseError = Timeline.LastReleaseTime - IdealEndTime;
+	AddInfo(FString::Printf(TEXT("Last of %d frames released %.3f ms after its time, end time error %.3f ms"), NumFrames, ReleaseError * 1000.0, Timeline.EndTimeError * 1000.0));
+	TestTrue(TEXT("Last frame released on time"), ReleaseError >= 0.0 && ReleaseError <= TEST_MAX_LATENESS_SECONDS);
+	TestNearlyEqual(TEXT("End time error of the timeline"), Timeline.EndTimeError, ReleaseError, 1.0e-6);
+	return true;
+}
+
+// Clock of a scheduler stepped by the test, its wait returns at the deadline plus a wake latency
+class FOmniverseSimulatedSchedulerClock : public IOmniverseSchedulerClock
+{
+public:
+	FOmniverseSimulatedSchedulerClock(double InTime, int32 InSeed)
+		: Time(InTime)
+		, Random(InSeed)
+	{
+	}
+
+	virtual double Seconds() override { return Time; }
+	virtual void WaitUntil(double InDeadline) override
+	{
+		Time = FMath::Max(Time, InDeadline) + Random.GetFraction() * TEST_WAKE_LATENCY_SECONDS;
+		++NumWaits;
+	}
+	virtual void Wake() override {}
+
+	double Time;
+	FRandomStream Random;
+	int32 NumWaits = 0;
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FOmniverseReleaseJitterTest, "Omniverse.LiveLink.FramePlayer.ReleaseJitter", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FOmniverseReleaseJitterTest::RunTest(const FString& Parameters)
+{
+	// Without listeners, the player only times the releases. The scheduler isn't started, the test steps it
+	TSharedPtr<FOmniverseSimulatedSchedulerClock> Clock = MakeShared<FOmniverseSimulatedSchedulerClock>(FPlatformTime::Seconds(), TEST_RELEASED_FRAMES);
+	FOmniverseFrameScheduler Scheduler(Clock);
+	TSharedPtr<FOmniverseLiveLinkFramePlayer, ESPMode::ThreadSafe> FramePlayer = MakeShared<FOmniverseLiveLinkFramePlayer, ESPMode::ThreadSafe>();
+	Scheduler.RegisterPlayer(FramePlayer);
+
+	// A burst stream as the listener pushes it, every frame waits for its release
+	const uint8 Header[] = { 'A', '2', 'F', ':', '3', '0' };
+	const uint8 FrameData[64] = {};
+	const uint8 EndOfStream[] = { 'E', 'O', 'S' };
+	FramePlayer->PushAnimeData_AnyThread(Header, sizeof(Header), 1, 0.0, true, false);
+	for (int32 FrameIndex = 0; FrameIndex < TEST_RELEASED_FRAMES; ++FrameIndex)
+	{
+		FramePlayer->PushAnimeData_AnyThread(FrameData, sizeof(FrameData), 1, FrameIndex == 0 ? TEST_DELAY_SECONDS : 1.0 / TEST_ANIMATION_FPS, false, false);
+	}
+	FramePlayer->PushAnimeData_AnyThread(EndOfStream, sizeof(EndOfStream), 1, 0.0, false, true);
+
+	while (Scheduler.Step())
+	{
+	}
+	Scheduler.UnregisterPlayer(FramePlayer);
+
+	double AverageLateness = 0.0;
+	double MaxLateness = 0.0;
+	const int32 NumReleases = FramePlayer->GetAnimeReleaseJitter(AverageLateness, MaxLateness);
+	AddInfo(FString::Printf(TEXT("Release lateness: average %.3f ms, max %.3f ms over %d frames, %d waits"), AverageLateness * 1000.0, MaxLateness * 1000.0, NumReleases, Clock->NumWaits));
+
+	// The scheduler adds no lateness of its own to the wake latency, and sleeps once per frame instead of polling
+	TestEqual(TEXT("Frames released on schedule"), NumReleases, TEST_RELEASED_FRAMES);
+	TestTrue(TEXT("Release lateness within the wake latency"), AverageLateness >= 0.0 && MaxLateness <= TEST_WAKE_LATENCY_SECONDS);
+	TestTrue(TEXT("One wait per frame"), Clock->NumWaits <= TEST_RELEASED_FRAMES + 1);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
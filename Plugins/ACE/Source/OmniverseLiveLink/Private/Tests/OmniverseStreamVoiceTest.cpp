@@ -0,0 +1,80 @@
+// Copyright(c) 2022-2023, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "CoreMinimal.h"
+#include "AudioMixer.h"
+#include "Misc/AutomationTest.h"
+#include "OmniverseStreamVoice.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#define TEST_BUFFER_FRAMES 1024
+#define TEST_DEVICE_CHANNELS 2
+#define TEST_DEVICE_SAMPLE_RATE 48000
+// The fade out of an interrupt, 5 ms at the device rate
+#define TEST_INTERRUPT_FADE_FRAMES 240
+
+static bool IsSilent(const TArray<float>& InAudio, int32 InStartFrame, int32 InNumChannels)
+{
+	for (int32 Index = InStartFrame * InNumChannels; Index < InAudio.Num(); ++Index)
+	{
+		if (InAudio[Index] != 0.0f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FOmniverseStreamVoiceInterruptTest, "Omniverse.LiveLink.StreamVoice.Interrupt", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FOmniverseStreamVoiceInterruptTest::RunTest(const FString& Parameters)
+{
+	FOmniverseStreamVoice Voice(1024 * 1024);
+	Voice.Activate(TEST_BUFFER_FRAMES);
+	FOmniverseVoiceScratch Scratch;
+	Scratch.PopBuffer.SetNumUninitialized(TEST_BUFFER_FRAMES * AUDIO_MIXER_MAX_OUTPUT_CHANNELS * sizeof(double));
+	Scratch.ResampleBuffer.SetNumUninitialized(TEST_BUFFER_FRAMES * 2);
+
+	// A second of a constant mono stream at the device rate
+	const FOmniverseWaveFormatInfo Format = { TEST_DEVICE_SAMPLE_RATE, 1, 32, 3 };
+	TArray<float> Samples;
+	Samples.Init(0.5f, TEST_DEVICE_SAMPLE_RATE);
+	Voice.BeginStream(Format, 1);
+	Voice.AppendStream((const uint8*)Samples.GetData(), Samples.Num() * sizeof(float), Format, 1);
+
+	TArray<float> Output;
+	Output.SetNumZeroed(TEST_BUFFER_FRAMES * TEST_DEVICE_CHANNELS);
+	for (int32 BufferIndex = 0; BufferIndex < 4; ++BufferIndex)
+	{
+		const FOmniverseVoiceRender Render = Voice.Render(Output.GetData(), TEST_BUFFER_FRAMES, TEST_DEVICE_CHANNELS, TEST_DEVICE_SAMPLE_RATE, Scratch);
+		TestEqual(TEXT("Frames rendered before the interrupt"), Render.RenderedFrames, TEST_BUFFER_FRAMES);
+	}
+	TestFalse(TEXT("Playing before the interrupt"), IsSilent(Output, TEST_BUFFER_FRAMES - 1, TEST_DEVICE_CHANNELS));
+
+	// The next buffer fades out what was playing and is silent after it, with most of the stream still queued
+	Voice.Interrupt();
+	const FOmniverseVoiceRender Interrupted = Voice.Render(Output.GetData(), TEST_BUFFER_FRAMES, TEST_DEVICE_CHANNELS, TEST_DEVICE_SAMPLE_RATE, Scratch);
+	TestEqual(TEXT("Frames rendered after the interrupt"), Interrupted.RenderedFrames, 0);
+	TestTrue(FString::Printf(TEXT("Silent from frame %d, within %d"), Interrupted.InterruptSilentFrame, TEST_INTERRUPT_FADE_FRAMES),
+		Interrupted.InterruptSilentFrame != INDEX_NONE && Interrupted.InterruptSilentFrame <= TEST_INTERRUPT_FADE_FRAMES);
+	TestTrue(TEXT("Zeros after the fade out"), Interrupted.bHasOutput && IsSilent(Output, TEST_INTERRUPT_FADE_FRAMES, TEST_DEVICE_CHANNELS));
+	TestTrue(TEXT("Ring flushed"), Voice.IsDrained());
+
+	const FOmniverseVoiceRender After = Voice.Render(Output.GetData(), TEST_BUFFER_FRAMES, TEST_DEVICE_CHANNELS, TEST_DEVICE_SAMPLE_RATE, Scratch);
+	TestTrue(TEXT("Silent buffer after the interrupt"), !After.bHasOutput || IsSilent(Output, 0, TEST_DEVICE_CHANNELS));
+
+	// A stream queued after the interrupt plays
+	Voice.BeginStream(Format, 1);
+	Voice.AppendStream((const uint8*)Samples.GetData(), Samples.Num() * sizeof(float), Format, 1);
+	const FOmniverseVoiceRender Next = Voice.Render(Output.GetData(), TEST_BUFFER_FRAMES, TEST_DEVICE_CHANNELS, TEST_DEVICE_SAMPLE_RATE, Scratch);
+	TestEqual(TEXT("Frames rendered of the next stream"), Next.RenderedFrames, TEST_BUFFER_FRAMES);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,77 @@
+// Copyright(c) 2022-2023, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+#include "OmniverseRenderCheck.h"
+#include "OmniverseSubmixListener.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// Device buffer of the test, the main device default
+#define TEST_BUFFER_FRAMES 1024
+#define TEST_DEVICE_CHANNELS 2
+#define TEST_DEVICE_SAMPLE_RATE 48000
+#define TEST_NUM_BUFFERS 64
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FOmniverseSubmixRenderAllocationTest, "Omniverse.LiveLink.SubmixListener.RenderAllocations", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FOmniverseSubmixRenderAllocationTest::RunTest(const FString& Parameters)
+{
+	FOmniverseSubmixListener Listener;
+	Listener.ActivateRender(TEST_BUFFER_FRAMES);
+
+	// A 16-bit mono stream resampled to the device, and a float stereo one at the device rate on another voice
+	const FOmniverseWaveFormatInfo PCMFormat = { 16000, 1, 16, 1 };
+	const FOmniverseWaveFormatInfo FloatFormat = { TEST_DEVICE_SAMPLE_RATE, 2, 32, 3 };
+
+	TArray<int16> PCMSamples;
+	PCMSamples.SetNumUninitialized(PCMFormat.SamplesPerSecond);
+	for (int32 Index = 0; Index < PCMSamples.Num(); ++Index)
+	{
+		PCMSamples[Index] = (int16)(FMath::Sin(2.0 * PI * 440.0 * Index / PCMFormat.SamplesPerSecond) * 8000.0);
+	}
+	TArray<float> FloatSamples;
+	FloatSamples.SetNumUninitialized(TEST_DEVICE_SAMPLE_RATE / 2 * FloatFormat.NumChannels);
+	for (int32 Index = 0; Index < FloatSamples.Num(); ++Index)
+	{
+		FloatSamples[Index] = FMath::Sin(2.0f * PI * 220.0f * (Index / 2) / TEST_DEVICE_SAMPLE_RATE) * 0.25f;
+	}
+
+	Listener.BeginStream(PCMFormat, 1);
+	Listener.AppendStream((const uint8*)PCMSamples.GetData(), PCMSamples.Num() * sizeof(int16), 1);
+	Listener.BeginStream(FloatFormat, 2);
+	Listener.AppendStream((const uint8*)FloatSamples.GetData(), FloatSamples.Num() * sizeof(float), 2);
+	Listener.EndStream(2);
+
+	// Both streams playing, the float one ending, an interrupt fading the other out, then silence
+	TArray<float> Output;
+	Output.SetNumZeroed(TEST_BUFFER_FRAMES * TEST_DEVICE_CHANNELS);
+	// Checked by the hook of the render path, the allocator of the running editor is left alone
+	const uint32 BufferHash = Listener.HashRenderBuffers();
+	int32 NumGrownBuffers = 0;
+	int32 NumLocks = 0;
+	for (int32 BufferIndex = 0; BufferIndex < TEST_NUM_BUFFERS; ++BufferIndex)
+	{
+		if (BufferIndex == TEST_NUM_BUFFERS / 2)
+		{
+			Listener.Interrupt();
+		}
+
+		FOmniverseRenderCheck::Begin();
+		Listener.Render(Output.GetData(), Output.Num(), TEST_DEVICE_CHANNELS, TEST_DEVICE_SAMPLE_RATE);
+		NumLocks += FOmniverseRenderCheck::End();
+		NumGrownBuffers += Listener.HashRenderBuffers() != BufferHash ? 1 : 0;
+	}
+
+	TestEqual(TEXT("Buffers reallocated by Render()"), NumGrownBuffers, 0);
+	TestEqual(TEXT("Locks taken by Render()"), NumLocks, 0);
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,30 @@
+// Copyright(c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// NVIDIA CORPORATION and its licensors retain all intellectual property
+// and proprietary rights in and to this software, related documentation
+// and any modifications thereto.Any use, reproduction, disclosure or
+// distribution of this software and related documentation without an express
+// license agreement from NVIDIA CORPORATION is strictly prohibited.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/SynthComponent.h"
+#include "OmniverseAudioStreamComponent.generated.h"
+
+/** Plays the audio of an Omniverse LiveLink source from the character, on the main audio device with its attenuation and spatialization. */
+UCLASS(ClassGroup = (Audio), meta = (BlueprintSpawnableComponent))
+class OMNIVERSELIVELINK_API UOmniverseAudioStreamComponent : public USynthComponent
+{
+	GENERATED_BODY()
+public:
+	/**  Audio port of the Omniverse LiveLink source to play. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Omniverse")
+	int32 AudioPort = 12031;
+
+protected:
+	// Begin USynthComponent Interface
+	virtual bool Init(int32& SampleRate) override;
+	virtual ISoundGeneratorPtr CreateSoundGenerator(const FSoundGeneratorInitParams& InParams) override;
+	// End USynthComponent Interface
+};
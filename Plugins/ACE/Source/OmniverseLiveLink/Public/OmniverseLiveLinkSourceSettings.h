@@ -18,12 +18,71 @@ class UOmniverseLiveLinkSourceSettings : public ULiveLinkSourceSettings
 {
 public:
 	GENERATED_BODY()
+
+	UOmniverseLiveLinkSourceSettings()
+	{
+		// Frames are played by the plugin's timeline, the engine time and timecode modes push them stamped as they arrive
+		Mode = ELiveLinkSourceMode::Latest;
+	}
+
+	/**  Adapt the delays to the measured network jitter, instead of the fixed delays. */
+	UPROPERTY(EditAnywhere, Category = "Settings")
+	bool bAdaptiveDelay = false;
+
+	/**  Blend the received frames to the engine frame rate, the frames synced to the audio are released one frame earlier to make up for the blend. */
+	UPROPERTY(EditAnywhere, Category = "Settings")
+	bool bInterpolateFrames = false;
+
 	/**  Milliseconds delay to wait before playing blendshapes animation. */
-	UPROPERTY(EditAnywhere, Category = "Settings", meta = (ClampMin = 0, ClampMax = 1000))
+	UPROPERTY(EditAnywhere, Category = "Settings", meta = (ClampMin = 0, ClampMax = 1000, EditCondition = "!bAdaptiveDelay"))
 	uint32 AnimationDelayTime = 150;
 
 	/**  Milliseconds delay to wait before playing audio. */
-	UPROPERTY(EditAnywhere, Category = "Settings", meta = (ClampMin = 0, ClampMax = 1000))
+	UPROPERTY(EditAnywhere, Category = "Settings", meta = (ClampMin = 0, ClampMax = 1000, EditCondition = "!bAdaptiveDelay"))
 	uint32 AudioDelayTime = 0;
 
+	/**  Minimum milliseconds of the adaptive animation delay. */
+	UPROPERTY(EditAnywhere, Category = "Adaptive Delay", meta = (ClampMin = 0, ClampMax = 1000, EditCondition = "bAdaptiveDelay"))
+	uint32 AnimationMinDelayTime = 20;
+
+	/**  Maximum milliseconds of the adaptive animation delay. */
+	UPROPERTY(EditAnywhere, Category = "Adaptive Delay", meta = (ClampMin = 0, ClampMax = 1000, EditCondition = "bAdaptiveDelay"))
+	uint32 AnimationMaxDelayTime = 500;
+
+	/**  Minimum milliseconds of the adaptive audio delay. */
+	UPROPERTY(EditAnywhere, Category = "Adaptive Delay", meta = (ClampMin = 0, ClampMax = 1000, EditCondition = "bAdaptiveDelay"))
+	uint32 AudioMinDelayTime = 0;
+
+	/**  Maximum milliseconds of the adaptive audio delay. */
+	UPROPERTY(EditAnywhere, Category = "Adaptive Delay", meta = (ClampMin = 0, ClampMax = 1000, EditCondition = "bAdaptiveDelay"))
+	uint32 AudioMaxDelayTime = 500;
+
+	/**  Percentage of packages allowed to arrive after their play time, the delay grows above it. */
+	UPROPERTY(EditAnywhere, Category = "Adaptive Delay", meta = (ClampMin = 0, ClampMax = 100, EditCondition = "bAdaptiveDelay"))
+	float TargetLatePercentage = 1.0f;
+
+	/**  Milliseconds delay currently used for the animation. */
+	UPROPERTY(VisibleAnywhere, Transient, Category = "Adaptive Delay")
+	float CurrentAnimationDelayTime = 0.0f;
+
+	/**  Estimated arrival jitter of the animation in milliseconds. */
+	UPROPERTY(VisibleAnywhere, Transient, Category = "Adaptive Delay")
+	float AnimationJitter = 0.0f;
+
+	/**  Animation frames which arrived after their play time. */
+	UPROPERTY(VisibleAnywhere, Transient, Category = "Adaptive Delay")
+	int32 LateAnimationFrames = 0;
+
+	/**  Milliseconds delay currently used for the audio. */
+	UPROPERTY(VisibleAnywhere, Transient, Category = "Adaptive Delay")
+	float CurrentAudioDelayTime = 0.0f;
+
+	/**  Estimated arrival jitter of the audio in milliseconds. */
+	UPROPERTY(VisibleAnywhere, Transient, Category = "Adaptive Delay")
+	float AudioJitter = 0.0f;
+
+	/**  Audio packages which arrived after their play time. */
+	UPROPERTY(VisibleAnywhere, Transient, Category = "Adaptive Delay")
+	int32 LateAudioPackages = 0;
+
 };
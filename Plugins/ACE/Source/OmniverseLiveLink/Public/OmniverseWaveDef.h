@@ -9,19 +9,22 @@
 #pragma once
 #include "CoreMinimal.h"
 
+// Sample type of a stream of Opus packets, one per package, decoded to float samples when received
+#define OMNIVERSE_WAVE_FORMAT_OPUS 0x704F
+
 struct FOmniverseWaveFormatInfo
 {
 	static const int32 NumMembers = 4;
 	int32 SamplesPerSecond;
 	int32 NumChannels;
 	int32 BitsPerSample;
-	int32 SampleType; // 1-PCM, 3-float
+	int32 SampleType; // 1-PCM, 3-float, 0x704F-Opus
 };
 
 inline bool operator==(const FOmniverseWaveFormatInfo& F1, const FOmniverseWaveFormatInfo& F2)
 {
-	return F1.SamplesPerSecond && F2.SamplesPerSecond 
-		&& F1.NumChannels && F2.NumChannels
-		&& F1.BitsPerSample && F2.BitsPerSample
-		&& F1.SampleType && F2.SampleType;
+	return F1.SamplesPerSecond == F2.SamplesPerSecond
+		&& F1.NumChannels == F2.NumChannels
+		&& F1.BitsPerSample == F2.BitsPerSample
+		&& F1.SampleType == F2.SampleType;
 }
@@ -8,6 +8,13 @@ import struct
 import time
 import threading
 
+# Sample type of the wave header for Opus packets, and the duration of each packet
+WAVE_FORMAT_OPUS = 0x704F
+OPUS_FRAME_MS = 10
+# Capture file of omni.CaptureStreams, "OVCP"
+CAPTURE_MAGIC = 0x5043564F
+CAPTURE_VERSION = 1
+
 class RepeatedTimer(object):
     def __init__(self, interval, function, *args, **kwargs):
         self._timer = None
@@ -48,12 +55,18 @@ class live_link_test_ue():
         self.sample_chunk_size = args.chunk_size
         self.frame_time = args.frame_time
         self.bs_fps = args.bs_fps
+        self.binary = args.binary
         self.stream_start_time = None
         self.audio_delay = args.audio_delay
         self.blendshape_delay = args.blendshape_delay
         self.wave_header = ""
+        self.opus = args.opus
+        self.opus_encoder = None
+        self.opus_pending = b""
         self.audio_socket = None
         self.blendshape_socket = None
+        self.interrupt_time = args.interrupt_time
+        self.interrupted = False
 
         if args.no_audio:
             self.all_audio_sent = True
@@ -86,6 +99,12 @@ class live_link_test_ue():
         #- WAVE_FORMAT_EXTENSIBLE
         print(f"rate: {self.wf.frequency}, channels: {self.wf.channels}, bits per sample: {self.wf.bits_per_sample}, format type: {self.wf.format}")
 
+        if self.opus:
+            # Opus only encodes 8, 12, 16, 24 or 48 kHz, from 16-bit PCM or float samples
+            import opuslib
+            self.opus_encoder = opuslib.Encoder(self.wf.frequency, self.wf.channels, opuslib.APPLICATION_VOIP)
+            self.opus_frame_size = self.wf.frequency * OPUS_FRAME_MS // 1000
+
         # open the blendshape data file
         self.a2f_json_file = open(a2f_json_fpath)
         self.a2f_json_data = json.load(self.a2f_json_file)
@@ -102,12 +121,80 @@ class live_link_test_ue():
         if socket:
             socket.send(send_data)
 
+    def pack_name(self, name):
+        encoded_name = bytes(name, "ascii")
+        return struct.pack("<H", len(encoded_name)) + encoded_name
+
+    def get_bones(self, subject_data):
+        # "Body" is an empty object when there's no bone
+        bones = subject_data.get("Body", [])
+        return bones if isinstance(bones, list) else []
+
+    def build_binary_header(self, frame):
+        '''
+        "A2F:<fps>:BIN", a NUL, then the subject name, bone names with parent index and curve names, all little-endian
+        '''
+        subject_name, subject_data = next(iter(frame.items()))
+        bones = self.get_bones(subject_data)
+        bone_names = [bone["Name"] for bone in bones]
+        curve_names = subject_data.get("Facial", {}).get("Names", [])
+
+        layout = self.pack_name(subject_name)
+        layout += struct.pack("<H", len(bones))
+        for bone in bones:
+            parent_index = bone_names.index(bone["ParentName"]) if bone["ParentName"] in bone_names else -1
+            layout += self.pack_name(bone["Name"]) + struct.pack("<h", parent_index)
+        layout += struct.pack("<H", len(curve_names))
+        for curve_name in curve_names:
+            layout += self.pack_name(curve_name)
+
+        return bytes(f"A2F:{self.bs_fps}:BIN", "ascii") + b"\0" + layout
+
+    def build_binary_frame(self, frame_index, frame):
+        '''
+        "BFRM", the frame index, then location xyz and rotation xyzw of each bone and the curve weights as float32
+        '''
+        _, subject_data = next(iter(frame.items()))
+        values = []
+        for bone in self.get_bones(subject_data):
+            values += bone["Location"] + bone["Rotation"]
+        values += subject_data.get("Facial", {}).get("Weights", [])
+        return b"BFRM" + struct.pack(f"<I{len(values)}f", frame_index, *values)
+
+    def encode_opus(self, sample_data, flush):
+        '''
+        Opus packets of 10 ms, one per package. The last partial frame is padded with silence
+        '''
+        self.opus_pending += sample_data
+        frame_bytes = self.opus_frame_size * self.wf.channels * (self.wf.bits_per_sample // 8)
+        if flush and len(self.opus_pending) % frame_bytes:
+            self.opus_pending += bytes(frame_bytes - len(self.opus_pending) % frame_bytes)
+
+        packets = []
+        while len(self.opus_pending) >= frame_bytes:
+            frame = self.opus_pending[:frame_bytes]
+            self.opus_pending = self.opus_pending[frame_bytes:]
+            if self.wf.format == 3:
+                packets.append(self.opus_encoder.encode_float(frame, self.opus_frame_size))
+            else:
+                packets.append(self.opus_encoder.encode(frame, self.opus_frame_size))
+        return packets
+
     def send_eos(self):
         eos_symbol = f"EOS"
         self.send_with_validation(self.audio_socket, eos_symbol, True)
         self.send_with_validation(self.blendshape_socket, eos_symbol, True)
         print("E", end="", flush=True)
 
+    def send_interrupt(self):
+        # Barge-in: Unreal drops the audio and animation of the source in flight, the face returns to neutral
+        interrupt_symbol = f"INT"
+        self.send_with_validation(self.audio_socket or self.blendshape_socket, interrupt_symbol, True)
+        self.interrupted = True
+        self.all_audio_sent = True
+        self.all_blendshapes_sent = True
+        print("I", end="", flush=True)
+
     def send_frame_data(self):
         '''
         Callled by a repeating timer to transmit the wave and blendshape data to Unreal, frame by frame
@@ -124,6 +211,12 @@ class live_link_test_ue():
 
         self.last_time = time.time()
 
+        if self.interrupted:
+            return
+        if self.interrupt_time > 0.0 and current_time - self.stream_start_time > self.interrupt_time:
+            self.send_interrupt()
+            return
+
         # send audio data --- account for the audio_start delay
         if current_time - self.stream_start_time > self.audio_delay:
             if not self.audio_header_sent:
@@ -136,7 +229,11 @@ class live_link_test_ue():
 
             if not self.all_audio_sent:
                 self.audio_sample_data = self.wf.read_samples(self.sample_chunk_size)
-                if self.audio_sample_data:
+                if self.opus_encoder:
+                    flush = self.audio_data_size == self.wf.tell()
+                    for packet in self.encode_opus(self.audio_sample_data or b"", flush):
+                        self.send_with_validation(self.audio_socket, packet, False)
+                elif self.audio_sample_data:
                     self.send_with_validation(self.audio_socket, self.audio_sample_data, False)
 
             # Print an A when the audio data is completely sent
@@ -149,14 +246,22 @@ class live_link_test_ue():
         if current_time - self.stream_start_time > self.blendshape_delay:
             if not self.blendshapes_header_sent:
                 print("b", end="", flush=True)
-                blendshape_header = f"A2F:{self.bs_fps}"
-                self.send_with_validation(self.blendshape_socket, blendshape_header, True)
+                if self.binary:
+                    blendshape_header = self.build_binary_header(self.a2f_json_data["0"])
+                    self.send_with_validation(self.blendshape_socket, blendshape_header, False)
+                else:
+                    blendshape_header = f"A2F:{self.bs_fps}"
+                    self.send_with_validation(self.blendshape_socket, blendshape_header, True)
                 self.blendshapes_header_sent = True
 
             if str(self.blendshape_frame_counter) in self.a2f_json_data.keys():        
                 out_data = self.a2f_json_data[str(self.blendshape_frame_counter)]
-                frame_data = json.dumps(out_data, separators=(",", ":"))
-                self.send_with_validation(self.blendshape_socket, frame_data, True)
+                if self.binary:
+                    frame_data = self.build_binary_frame(self.blendshape_frame_counter, out_data)
+                    self.send_with_validation(self.blendshape_socket, frame_data, False)
+                else:
+                    frame_data = json.dumps(out_data, separators=(",", ":"))
+                    self.send_with_validation(self.blendshape_socket, frame_data, True)
                 self.blendshape_frame_counter += 1
             elif not self.all_blendshapes_sent:
                 # Print a B when the blendshape data is completely sent
@@ -173,6 +278,9 @@ class live_link_test_ue():
         self.blendshape_frame_counter = 0
 
         self.wave_header = f"WAVE:{self.wf.frequency}:{self.wf.channels}:{self.wf.bits_per_sample}:{self.wf.format}"
+        if self.opus_encoder:
+            # Decoded to float samples by the receiver
+            self.wave_header = f"WAVE:{self.wf.frequency}:{self.wf.channels}:32:{WAVE_FORMAT_OPUS}"
         print(f"Wave data stream header: {self.wave_header}")
 
         self.stream_start_time = self.last_time
@@ -180,7 +288,12 @@ class live_link_test_ue():
         if self.frame_time < 0.001:
             while not (self.all_audio_sent and self.all_blendshapes_sent):
                 self.send_frame_data()
-            self.send_eos()
+            if not self.interrupted:
+                self.send_eos()
+            if self.interrupt_time > 0.0 and not self.interrupted:
+                # The burst is buffered by Unreal, interrupt its playback
+                time.sleep(self.interrupt_time)
+                self.send_interrupt()
         else:
             rt = RepeatedTimer(self.frame_time, self.send_frame_data)  # it auto-starts, no need of rt.start()
             try:
@@ -188,9 +301,10 @@ class live_link_test_ue():
                 sleep_time = (self.wf.samples / self.wf.frequency) * 1.1 + self.audio_delay + self.blendshape_delay
                 print(f"Waiting for {sleep_time} seconds")
 
-                # if we're streaming blendshapes there's no reason to send a blendshape header
-                self.blendshapes_header_sent = True
-                print("b", end="", flush=True)
+                # if we're streaming blendshapes there's no reason to send a blendshape header, except the binary layout
+                if not self.binary:
+                    self.blendshapes_header_sent = True
+                    print("b", end="", flush=True)
 
                 time.sleep(sleep_time)  # your long-running job goes here...
             finally:
@@ -213,6 +327,45 @@ class live_link_test_ue():
             self.blendshape_socket.close()
 
 
+def replay_capture(capture_fpath, remote_address, port):
+    '''
+    Replays a capture of omni.CaptureStreams: each package is sent at the time it was received, on a socket per recorded connection
+    '''
+    with open(capture_fpath, "rb") as capture_file:
+        header_format = "<IIIdq"
+        magic, version, capture_port, _, _ = struct.unpack(header_format, capture_file.read(struct.calcsize(header_format)))
+        if magic != CAPTURE_MAGIC or version != CAPTURE_VERSION:
+            print(f"{capture_fpath} is no capture file")
+            return
+        port = port if port else capture_port
+        print(f"Replaying the capture of port {capture_port} to {remote_address}:{port}")
+
+        record_format = "<dII"
+        record_size = struct.calcsize(record_format)
+        sockets = {}
+        start_time = time.time()
+        while True:
+            record_header = capture_file.read(record_size)
+            if len(record_header) < record_size:
+                break
+            receive_time, connection_id, size = struct.unpack(record_format, record_header)
+            package = capture_file.read(size)
+            if len(package) < size:
+                break
+
+            delay = start_time + receive_time - time.time()
+            if delay > 0:
+                time.sleep(delay)
+            if connection_id not in sockets:
+                sockets[connection_id] = socket.create_connection((remote_address, port))
+            sockets[connection_id].sendall(struct.pack("!Q", size) + package)
+            print(".", end="", flush=True)
+
+        for connection_socket in sockets.values():
+            connection_socket.close()
+        print(f"\nReplayed {len(sockets)} connections")
+
+
 if __name__ == "__main__":
     default_audio_fpath = os.path.join(os.path.dirname(os.path.realpath(__file__)), "audio_violet.wav")
     default_a2f_json_fpath = os.path.join(os.path.dirname(os.path.realpath(__file__)), "bs_violet.json")
@@ -230,10 +383,20 @@ if __name__ == "__main__":
     parser.add_argument("-p", "--blendshape-fps", dest="bs_fps", action="store", default=30.0, type=float, required=False, help="FPS value in blendshape JSON data")
     parser.add_argument("-d", "--audio-delay", dest="audio_delay", action="store", default=0.0, type=float, required=False, help="Seconds delay to wait before sending audio")
     parser.add_argument("-e", "--blendshape-delay", dest="blendshape_delay", action="store", default=0.0, type=float, required=False, help="Seconds delay to wait before sending blendshapes")
+    parser.add_argument("-B", "--binary", dest="binary", action="store_true", default=False, required=False, help="Pass this to send blendshapes in the binary frame format")
+    parser.add_argument("-O", "--opus", dest="opus", action="store_true", default=False, required=False, help="Pass this to send the audio as Opus packets (requires opuslib)")
     parser.add_argument("-n", "--no-audio", dest="no_audio", action="store_true", default=False, required=False, help="Pass this to send no audio data")
+    parser.add_argument("-i", "--interrupt", dest="interrupt_time", action="store", default=0.0, type=float, required=False, help="Seconds after the stream start to send an interrupt instead of the rest of the stream, 0 for none")
+
+    parser.add_argument("-C", "--capture-file", dest="capture_file", action="store", default=None, required=False, help="Replays a capture of omni.CaptureStreams instead of the wave and blendshape files")
+    parser.add_argument("-P", "--capture-port", dest="capture_port", action="store", default=0, type=int, required=False, help="Port the capture is replayed to, 0 for the port it was recorded on")
 
     args = parser.parse_args()
 
+    if args.capture_file:
+        replay_capture(args.capture_file, args.remote_address, args.capture_port)
+        exit()
+
     live_link_inst = live_link_test_ue(args)
     live_link_inst.initiate_data_transfer()
     live_link_inst.close()